@@ -0,0 +1,388 @@
+#include "cgol.hpp"
+#include "kernels.hpp"
+#include "sparse.hpp"
+#include "thread_pool.hpp"
+#include "scheduler.hpp"
+#include "parser_utils.hpp"
+#include "ensemble.hpp"
+#include "mapped.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Generations per second of one engine on a random torus of the given size.
+double gens_per_second(size_t width, size_t height, Engine engine, const Rule& rule = rules::CONWAY,
+                       ThreadPool* pool = nullptr, double min_seconds = 0.5) {
+    Grid grid(width, height);
+    Grid back(width, height);
+    grid.random();
+    grid.set_rule(rule);
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    size_t gens = 0;
+    double elapsed = 0;
+    do {
+        grid.step_into(back, engine, pool);
+        std::swap(grid, back);
+        ++gens;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < min_seconds);
+
+    return gens / elapsed;
+}
+
+// Row-strip stepping on 1, 2, 4, ... threads up to one per hardware thread.
+void thread_scaling(size_t size) {
+    const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    const double single = gens_per_second(size, size, Engine::Bitsliced);
+    std::cout << "threads 1 on " << size << "x" << size << ": " << single << " gens/s" << std::endl;
+    std::vector<size_t> counts;
+    for (size_t threads = 2; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    if (max_threads > 1) {
+        counts.push_back(max_threads);
+    }
+    for (size_t threads : counts) {
+        ThreadPool pool(threads, true);
+        const double rate = gens_per_second(size, size, Engine::Bitsliced, rules::CONWAY, &pool);
+        std::cout << "threads " << threads << (pool.is_pinned() ? " pinned" : "") << ": " << rate << " gens/s ("
+                  << rate / single << "x)" << std::endl;
+    }
+}
+
+// n generations on every hardware thread, synchronised by a barrier per
+// generation and by the wavefront, with the time workers spent waiting.
+void wavefront(size_t size, uint64_t n) {
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool pool(threads, true);
+    Grid grid(size, size);
+    grid.random();
+    Grid out(size, size);
+    using clock = std::chrono::steady_clock;
+    for (bool barrier : {true, false}) {
+        Wavefront wavefront;
+        wavefront.barrier = barrier;
+        const auto start = clock::now();
+        grid.advance_wavefront(out, n, &pool, wavefront);
+        const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        const double total = wavefront.busy_seconds + wavefront.wait_seconds;
+        std::cout << (barrier ? "barrier   " : "wavefront ") << threads << " threads on " << size << "x" << size << ": "
+                  << n / elapsed << " gens/s, " << wavefront.wait_seconds * 1000 << " ms waiting ("
+                  << (total > 0 ? wavefront.wait_seconds / total * 100 : 0) << "% of worker time)" << std::endl;
+    }
+}
+
+// Copperheads and one soup in a large empty board: strips against work-stolen
+// tiles, with each worker's utilization and steals over the last generation.
+void work_stealing(size_t size) {
+    FileHandler f;
+    const Grid copperhead = f.read("data/copperhead.rle");
+    Grid board(size, size);
+    for (size_t i = 1; i < 8; ++i) {
+        board.place(copperhead, size * i / 8, size * i / 8);
+    }
+    Grid soup(size / 8, size / 8);
+    soup.random();
+    board.place(soup, size / 16, size * 3 / 4);
+
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    using clock = std::chrono::steady_clock;
+    for (Schedule schedule : {Schedule::Strips, Schedule::WorkStealing}) {
+        Simulation s(board);
+        s.set_history(false);
+        s.set_threads(threads, true, schedule);
+        const auto start = clock::now();
+        const int gens = 200;
+        for (int gen = 0; gen < gens; ++gen) {
+            s.step();
+        }
+        const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        std::cout << (schedule == Schedule::Strips ? "strips        " : "work stealing ") << threads << " threads on "
+                  << size << "x" << size << ": " << gens / elapsed << " gens/s" << std::endl;
+        if (const WorkStealingScheduler* scheduler = s.get_scheduler()) {
+            const TileActivity& tiles = s.get_tile_activity();
+            std::cout << "  " << tiles.computed << " of " << tiles.columns * tiles.rows << " tiles computed" << std::endl;
+            for (size_t w = 0; w < scheduler->size(); ++w) {
+                const WorkStealingScheduler::WorkerStats& stats = scheduler->last_stats()[w];
+                std::cout << "  worker " << w << ": " << stats.tasks << " tiles, " << stats.steals << " stolen, "
+                          << scheduler->utilization(w) * 100 << "% busy" << std::endl;
+            }
+        }
+    }
+}
+
+// Universe generations per second of n small random universes, stepped as one
+// Simulation each and as one bit-sliced ensemble.
+void ensemble(size_t n, size_t side) {
+    using clock = std::chrono::steady_clock;
+    const int gens = 100;
+
+    std::vector<Simulation> sims;
+    for (size_t u = 0; u < n; ++u) {
+        Grid g(side, side);
+        g.random();
+        sims.emplace_back(g);
+        sims.back().set_history(false);
+    }
+    auto start = clock::now();
+    for (int gen = 0; gen < gens; ++gen) {
+        for (Simulation& s : sims) s.step();
+    }
+    const double separate = n * gens / std::chrono::duration<double>(clock::now() - start).count();
+
+    Ensemble e(n, side, side);
+    e.random();
+    start = clock::now();
+    e.advance(gens);
+    const double batched = n * gens / std::chrono::duration<double>(clock::now() - start).count();
+
+    std::cout << n << " universes of " << side << "x" << side << ": " << separate << " universe-gens/s separately, "
+              << batched << " as an ensemble (" << batched / separate << "x)" << std::endl;
+}
+
+// Memory of n generations of history of a soup, compressed against full grids,
+// and what walking back over half of them costs, without and with a budget.
+void history(size_t size, int n) {
+    Grid grid(size, size);
+    grid.random();
+    for (uint64_t budget : {uint64_t(0), uint64_t(size * size / 8 * 16)}) {
+        Simulation s(grid);
+        s.set_history_budget(budget);
+        for (int gen = 0; gen < n; ++gen) {
+            s.step();
+        }
+        const HistoryStats stored = s.get_history_stats();
+        for (int gen = 0; gen < n / 2; ++gen) {
+            s.prev();
+        }
+        const HistoryStats stats = s.get_history_stats();
+        std::cout << "history of " << n << " generations on " << size << "x" << size;
+        if (budget) {
+            std::cout << " in " << budget / 1048576.0 << " MiB";
+        }
+        std::cout << ": " << stored.bytes / 1048576.0 << " MiB vs " << stored.raw_bytes / 1048576.0 << " MiB of grids ("
+                  << double(stored.bytes) / stored.raw_bytes * 100 << "%), " << stored.keyframes << " keyframes";
+        if (stored.spacing) {
+            std::cout << " " << stored.spacing << " apart, " << stored.dropped << " entries dropped";
+        }
+        std::cout << "; prev() " << stats.backward_seconds / stats.backward_seeks * 1e6 << " us, recomputing "
+                  << double(stats.backward_recomputed) / stats.backward_seeks << " generations" << std::endl;
+    }
+}
+
+// Keeping every generation of a board where only a corner is busy: copies share
+// the bands that did not change, so a snapshot costs a pointer per band and a
+// generation allocates only the bands it changed.
+void snapshots(size_t size, int n) {
+    Grid board(size, size);
+    Grid soup(size / 8, size / 8);
+    soup.random();
+    board.place(soup, 0, 0);
+    Simulation s(board);
+    s.set_history(false);
+
+    using clock = std::chrono::steady_clock;
+    std::vector<Grid> kept;
+    double copying = 0;
+    const uint64_t allocations = grid_allocations;
+    for (int gen = 0; gen < n; ++gen) {
+        s.step();
+        const auto start = clock::now();
+        kept.push_back(s.cur());
+        copying += std::chrono::duration<double>(clock::now() - start).count();
+    }
+    std::cout << n << " snapshots of " << size << "x" << size << " with a busy corner: "
+              << copying / n * 1e6 << " us per cur(), " << double(grid_allocations - allocations) / n
+              << " of " << board.get_bands() << " bands allocated per generation" << std::endl;
+}
+
+// Generations per second when every generation is a new grid, get_next_state
+// style, with the buffer pool off and on.
+void buffer_pool_churn(size_t size) {
+    const size_t limit = buffer_pool::get_limit();
+    for (size_t pooled : {size_t(0), limit}) {
+        buffer_pool::set_limit(pooled);
+        buffer_pool::reset_stats();
+        Grid grid(size, size);
+        grid.random();
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        const int gens = 200;
+        for (int gen = 0; gen < gens; ++gen) {
+            grid = grid.get_next_state();
+        }
+        const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        const BufferPoolStats stats = buffer_pool::stats();
+        std::cout << "new grid per generation, pool " << (pooled ? "on " : "off") << ": " << gens / elapsed
+                  << " gens/s, " << stats.hits << " hits, " << stats.misses << " misses" << std::endl;
+    }
+    buffer_pool::set_limit(limit);
+}
+
+// Decoding speed of the RLE of a soup, read from memory.
+void rle_decode(size_t size) {
+    Grid grid(size, size);
+    grid.random();
+    std::stringstream encoded;
+    RLE_Parser(encoded).save(grid);
+    const double mib = encoded.str().size() / 1048576.0;
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    const Grid decoded = RLE_Parser(encoded).read();
+    const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    std::cout << "rle decode of " << size << "x" << size << " soup: " << mib << " MiB at " << mib / elapsed
+              << " MiB/s" << (decoded == grid ? "" : ", MISMATCH") << std::endl;
+
+    // the same from a file, which FileHandler maps and parses in place
+    const std::string path = "bench.rle";
+    std::ofstream(path, std::ios::binary) << encoded.str();
+    const auto load_start = clock::now();
+    const Grid loaded = FileHandler().read(path);
+    const double load = std::chrono::duration<double>(clock::now() - load_start).count();
+    std::cout << "rle load from a mapped file: " << load * 1000 << " ms, " << mib / load << " MiB/s"
+              << (loaded == grid ? "" : ", MISMATCH") << std::endl;
+    std::remove(path.c_str());
+}
+
+// Saving a large board with few live cells, whose empty rows cost a word scan.
+void sparse_save(size_t size, size_t live) {
+    Grid grid(size, size);
+    // a few bands of scattered cells, so the empty ones stay one shared band
+    std::mt19937_64 rng(1);
+    for (size_t i = 0; i < live; ++i) {
+        grid.set_cell(rng() % size, size / 4 * (i % 4) + rng() % Grid::BAND_ROWS, LIVE);
+    }
+
+    using clock = std::chrono::steady_clock;
+    for (const char* format : {"rle", "life"}) {
+        std::stringstream out;
+        const auto start = clock::now();
+        if (format == std::string("rle")) RLE_Parser(out).save(grid);
+        else Life106_Parser(out).save(grid);
+        const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        std::cout << format << " save of " << size << "x" << size << " with " << live << " live cells: "
+                  << elapsed * 1000 << " ms, " << out.str().size() << " bytes" << std::endl;
+    }
+}
+
+// Storage traffic of a board file stepped out of core, per generation.
+void out_of_core(size_t size, uint64_t n) {
+    const std::string path = "bench.board";
+    std::remove(path.c_str());
+    Grid grid(size, size);
+    grid.random();
+    MappedGrid::create(path, grid);
+    {
+        MappedGrid m(path);
+        m.advance(n);
+        const MappedStats& stats = m.get_stats();
+        const double mib = 1048576.0;
+        std::cout << "mapped " << size << "x" << size << ": " << n / stats.seconds << " gens/s, per generation "
+                  << stats.bytes_read / mib / n << " MiB in, " << stats.bytes_written / mib / n << " MiB out ("
+                  << (stats.bytes_read + stats.bytes_written) / mib / stats.seconds << " MiB/s), storage "
+                  << stats.disk_read_bytes / mib / n << " MiB in, " << stats.disk_written_bytes / mib / n
+                  << " MiB out, " << stats.sync_seconds / stats.seconds * 100 << "% syncing" << std::endl;
+    }
+    std::remove(path.c_str());
+}
+
+// One pass per generation against temporal blocking, over n generations.
+void temporal_blocking(size_t size, uint64_t n) {
+    Grid grid(size, size);
+    grid.random();
+    Grid out(size, size);
+    Grid back(size, size);
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    out = grid;
+    for (uint64_t i = 0; i < n; ++i) {
+        out.step_into(back);
+        std::swap(out, back);
+    }
+    const double stepped = std::chrono::duration<double>(clock::now() - start).count();
+
+    for (size_t depth : {4, 8, 16}) {
+        TemporalBlocking blocking;
+        blocking.depth = depth;
+        start = clock::now();
+        grid.advance_blocked(back, n, blocking);
+        const double blocked = std::chrono::duration<double>(clock::now() - start).count();
+        std::cout << "temporal blocking depth " << depth << ": " << n / blocked << " gens/s vs "
+                  << n / stepped << " stepped (" << stepped / blocked << "x), "
+                  << blocking.bytes_moved / 1048576 << " MiB moved vs " << blocking.naive_bytes / 1048576
+                  << " MiB (" << double(blocking.naive_bytes) / blocking.bytes_moved << "x less)" << std::endl;
+    }
+}
+
+// Seconds per generation of a settling soup in the sparse universe, early and late.
+void sparse_soup(size_t size) {
+    Grid soup(size, size);
+    soup.random();
+    SparseUniverse u(soup);
+
+    using clock = std::chrono::steady_clock;
+    for (int phase = 0; phase < 3; ++phase) {
+        const auto start = clock::now();
+        size_t computed = 0;
+        for (int gen = 0; gen < 100; ++gen) {
+            u.step();
+            computed += u.last_step().computed;
+        }
+        const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        std::cout << "sparse soup gens " << u.get_generation() - 100 << "-" << u.get_generation() << ": "
+                  << elapsed * 1e6 / 100 << " us/gen, " << computed / 100 << " of " << u.tile_count() << " tiles computed" << std::endl;
+        u.advance(1000);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t size = argc > 1 ? std::stoul(argv[1]) : 1024;
+
+    std::cout << "board " << size << "x" << size << ", kernel " << kernels::isa_name(kernels::active_isa()) << std::endl;
+
+    const kernels::Isa startup = kernels::active_isa();
+    const double naive = gens_per_second(size, size, Engine::Naive);
+    std::cout << "naive      " << naive << " gens/s" << std::endl;
+
+    for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2, kernels::Isa::AVX512}) {
+        if (!kernels::isa_supported(isa)) {
+            continue;
+        }
+        kernels::set_isa(isa);
+        const double bitsliced = gens_per_second(size, size, Engine::Bitsliced);
+        std::cout << "bitsliced " << kernels::isa_name(isa) << " " << bitsliced << " gens/s (" << bitsliced / naive << "x)" << std::endl;
+    }
+    kernels::set_isa(startup);
+
+    // the last one has no dedicated kernel and runs the generic one
+    for (const char* rule : {"B3/S23", "B36/S23", "B3678/S34678", "B2/S", "B36/S125"}) {
+        std::cout << "rule " << rule << " " << gens_per_second(size, size, Engine::Bitsliced, Rule::parse(rule)) << " gens/s" << std::endl;
+    }
+
+    thread_scaling(std::max<size_t>(size, 8192));
+    work_stealing(std::max<size_t>(size, 4096));
+    wavefront(std::max<size_t>(size, 4096), 100);
+    ensemble(4096, 16);
+    ensemble(4096, 32);
+    temporal_blocking(std::max<size_t>(size, 4096), 64);
+    history(1000, 1000);
+    snapshots(std::max<size_t>(size, 4096), 100);
+    buffer_pool_churn(size);
+    rle_decode(std::max<size_t>(size, 4096));
+    sparse_save(100000, 100000);
+    out_of_core(std::max<size_t>(size, 16384), 10);
+    sparse_soup(size);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef CGOL_BITS_HPP
+#define CGOL_BITS_HPP
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Bit scans on packed cell words. The scans expect a non-zero word.
+
+inline int count_trailing_zeros(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return int(i);
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+inline int count_leading_zeros(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return 63 - int(i);
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+inline int popcount(uint64_t v) {
+#ifdef _MSC_VER
+    return int(__popcnt64(v));
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+#endif /* CGOL_BITS_HPP */
@@ -0,0 +1,45 @@
+#ifndef CGOL_BUFFER_POOL_HPP
+#define CGOL_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Counters of the buffer pool since the last reset_stats().
+struct BufferPoolStats {
+    uint64_t hits = 0;     // allocations served from a free list
+    uint64_t misses = 0;   // allocations that went to the system
+    uint64_t returned = 0; // buffers put back on a free list
+    uint64_t released = 0; // buffers freed to the system, the pool being full
+    // held on the free lists now
+    uint64_t pooled_buffers = 0;
+    uint64_t pooled_bytes = 0;
+};
+
+// A process-wide pool of aligned buffers behind AlignedAllocator, so the bands
+// of grids, history scratch and temporaries recycle each other's storage instead
+// of going back to the system. Sizes are rounded up to classes four to an octave,
+// wasting at most a quarter, and a freed buffer waits on its class's free list
+// until a request of the same class and alignment takes it. Buffers of
+// HUGE_PAGE and more are aligned to it and, on Linux, advised to be backed by
+// huge pages. Past the limit freed buffers go back to the system.
+namespace buffer_pool {
+
+constexpr size_t HUGE_PAGE = size_t(2) << 20;
+constexpr size_t DEFAULT_LIMIT = size_t(256) << 20;
+
+// at least bytes of storage aligned to align, a power of two
+void* allocate(size_t bytes, size_t align);
+// p must come from allocate with the same bytes and align
+void deallocate(void* p, size_t bytes, size_t align);
+
+BufferPoolStats stats();
+void reset_stats();
+// bytes the free lists may hold, 0 to pool nothing; lowering it frees the excess
+void set_limit(size_t bytes);
+size_t get_limit();
+// frees every pooled buffer
+void trim();
+
+} // namespace buffer_pool
+
+#endif /* CGOL_BUFFER_POOL_HPP */
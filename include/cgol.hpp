@@ -1,71 +1,638 @@
 #ifndef CGOL_HPP
 #define CGOL_HPP
 
+#include "rule.hpp"
+#include "buffer_pool.hpp"
+#include "bits.hpp"
+
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
 
 #define LIVE true
 #define DEAD false
 
+// Cell buffers allocated so far by the process, on any thread, so the
+// allocations of pool workers are counted along with the caller's.
+inline std::atomic<uint64_t> grid_allocations{0};
+
+// Allocator returning storage aligned to Align bytes (a cache line by default),
+// recycled through buffer_pool.
+template <class T, size_t Align = 64>
+struct AlignedAllocator {
+    using value_type = T;
+    template <class U> struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template <class U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(size_t n) {
+        grid_allocations.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<T*>(buffer_pool::allocate(n * sizeof(T), Align));
+    }
+    void deallocate(T* p, size_t n) {
+        buffer_pool::deallocate(p, n * sizeof(T), Align);
+    }
+
+    template <class U> bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <class U> bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+// Stepping engines, all producing identical generations.
+enum class Engine {
+    Naive,     // per-cell neighbour count
+    Bitsliced  // 64 cells per word operation
+};
+
+// How Simulation::advance covers many generations at once.
+enum class AdvanceMode {
+    Step,             // one get_next_state per generation
+    HashLife,         // memoized power-of-two jumps, see hashlife.hpp
+    TemporalBlocking, // several generations per cache-resident tile, see Grid::advance_blocked
+    Processes,        // slabs stepped by separate processes trading halos, see domain.hpp
+    Wavefront         // strips pipelined across generations, see Grid::advance_wavefront
+};
+
+// Tuning and traffic report of Grid::advance_blocked.
+struct TemporalBlocking {
+    size_t tile_rows = 0; // rows written back per tile, 0 sizes tiles to the L2 cache
+    size_t depth = 8;     // generations computed per pass over memory
+    // bytes the last advance moved to and from memory, and what one pass per generation moves
+    uint64_t bytes_moved = 0;
+    uint64_t naive_bytes = 0;
+};
+
+// Mode and wait report of Grid::advance_wavefront.
+struct Wavefront {
+    bool barrier = false; // every strip waits for all others each generation, for comparison
+    // seconds the workers spent computing and waiting for other strips in the
+    // last advance, summed over workers
+    double busy_seconds = 0;
+    double wait_seconds = 0;
+};
+
+class ThreadPool;
+class WorkStealingScheduler;
+class HashLife;
+
+// How the threads of a Simulation split a generation.
+enum class Schedule {
+    Strips,      // one fixed strip of rows per thread
+    WorkStealing // tiles near recent changes, balanced by work stealing
+};
+
+class Grid;
+
+// Change map of Grid::step_tiles. The board is cut into tiles of TILE_ROWS rows
+// by TILE_WORDS words; a tile is only recomputed when it or a neighbour changed
+// in the last step, every other tile keeps its state.
+struct TileActivity {
+    static constexpr size_t TILE_ROWS = 64;
+    static constexpr size_t TILE_WORDS = 8;
+
+    size_t columns = 0; // tiles across
+    size_t rows = 0;    // tiles down
+    std::vector<uint8_t> changed; // per tile in the last step, empty when unknown
+    // epochs of the last step's source and result, see Grid::get_epoch
+    uint64_t source = 0;
+    uint64_t target = 0;
+    // tiles the last step ran the kernel on, copied unchanged, and left alone
+    uint64_t computed = 0;
+    uint64_t copied = 0;
+    uint64_t skipped = 0;
+
+    // forgets the change map, so the next step computes every tile
+    void invalidate() { changed.clear(); }
+    // true if g is the last result, unchanged since
+    bool describes(const Grid& g) const;
+    // After an edit of cell (x, y) of g, which describes() held for right before
+    // it, marks its tile as changed and takes g as the last result again.
+    void touch(Grid& g, size_t x, size_t y);
+};
+
+// Cells are stored row-major, 64 per word, bit x%64 of word x/64 holding column x.
+// Each row starts on a cache line; bits past the width and padding words stay zero.
+//
+// The rows are kept in bands of BAND_ROWS, each its own reference-counted
+// buffer. Copying a grid shares its bands, and a band is only copied when one
+// of the grids sharing it writes to it, so copies cost a pointer per band and a
+// step allocates only the bands that changed. Rows of a band are contiguous.
+class GridView;
+
 class Grid {
 public:
     friend class Simulation;
+    friend class GridView;
+    friend struct TileActivity;
+
+    using word_t = uint64_t;
+    static constexpr size_t WORD_BITS = 64;
+    static constexpr size_t ROW_ALIGN = 8; // words per cache line
+    static constexpr size_t BAND_ROWS = 64;
 
     Grid(size_t w, size_t h);
     Grid(size_t w, size_t h, const std::vector<std::vector<bool>>& other);
-    bool get_cell(size_t x, size_t y) const { return grid[x][y]; };
-    void set_cell(size_t x, size_t y, bool state) { grid[x][y] = state; }
+    // the cells of a view; a view of a whole grid shares its bands
+    explicit Grid(const GridView& view);
+    bool get_cell(size_t x, size_t y) const { return (row(y)[x / WORD_BITS] >> (x % WORD_BITS)) & 1; };
+    void set_cell(size_t x, size_t y, bool state) {
+        const word_t bit = word_t(1) << (x % WORD_BITS);
+        if (state) row(y)[x / WORD_BITS] |= bit;
+        else row(y)[x / WORD_BITS] &= ~bit;
+    }
+
+    // raw access to the packed words of row y; the writable one first gives
+    // this grid a copy of the row's band if it shares it
+    word_t* row(size_t y) { return band_data(y / BAND_ROWS) + y % BAND_ROWS * stride; }
+    const word_t* row(size_t y) const { return bands[y / BAND_ROWS]->data() + y % BAND_ROWS * stride; }
+    size_t get_stride() const { return stride; }
+    size_t get_row_words() const { return (width + WORD_BITS - 1) / WORD_BITS; }
+    // valid cell bits of the last word in a row
+    word_t last_word_mask() const {
+        return width % WORD_BITS ? (word_t(1) << (width % WORD_BITS)) - 1 : ~word_t(0);
+    }
+
+    // Names the contents: a step_tiles() result gets a new epoch, which copies
+    // keep, and any write, the rule's included, sets it back to 0 for unknown.
+    uint64_t get_epoch() const { return epoch.value.load(std::memory_order_relaxed); }
+
+    size_t get_bands() const { return bands.size(); }
+    // true if band b is the same buffer in both grids
+    bool shares_band(const Grid& other, size_t b) const { return bands[b] == other.bands[b]; }
+    // bands this grid shares with any other grid
+    size_t count_shared_bands() const;
+    // copies every shared band, so later writes never allocate
+    void detach();
+
+    bool operator==(const Grid& other) const;
+    bool operator!=(const Grid& other) const { return !(*this == other); }
 
     void random();
 
-    void place(const Grid& other, size_t x, size_t y);
-    void place_center(const Grid& other);
+    void place(const GridView& other, size_t x, size_t y);
+    void place_center(const GridView& other);
 
     int get_neighbors(size_t x, size_t y, bool wrap = true) const;
-    Grid get_next_state() const;
+    Grid get_next_state(Engine engine = Engine::Bitsliced) const;
+    // Writes the next state into a grid of the same size, allocating only for
+    // bands that change while out shares them. With a pool the bitsliced engine
+    // gives each worker one run of bands; workers only read their neighbours'
+    // edge rows, so the result is the same for any thread count.
+    void step_into(Grid& out, Engine engine = Engine::Bitsliced, ThreadPool* pool = nullptr) const;
+    // Writes the state n generations ahead into a grid of the same size. Each tile
+    // of rows is loaded with a halo of `depth` rows, advanced `depth` generations
+    // while it stays in cache, and written back once.
+    void advance_blocked(Grid& out, uint64_t n, TemporalBlocking& blocking) const;
+    // Writes the state n generations on into a grid of the same size, one strip
+    // of rows per pool worker (or one strip on the calling thread without a
+    // pool). There is no barrier between generations: a strip moves on as soon
+    // as the strips next to it caught up, signalled through per-strip atomic
+    // generation counters, so a slow strip only holds up its neighbours.
+    void advance_wavefront(Grid& out, uint64_t n, ThreadPool* pool, Wavefront& wavefront) const;
+    // Writes the next state into a grid of the same size, running the tiles near
+    // the changes of the last step as work-stealing tasks. The map carries over
+    // when this grid is the previous result; edits in between must be touch()ed.
+    // When out is the previous source, unchanged tiles are not even copied.
+    void step_tiles(Grid& out, WorkStealingScheduler& scheduler, TileActivity& activity) const;
 
     Grid get_minimal() const;
 
     size_t get_width() const { return width; }
     size_t get_height() const { return height; }
+    // the rule next states are computed with, carried over by step_into
+    const Rule& get_rule() const { return rule; }
+    void set_rule(const Rule& r) {
+        rule = r;
+        unstamp();
+    }
     void display() const;
 private:
+    using Band = std::vector<word_t, AlignedAllocator<word_t>>;
+
+    size_t band_rows(size_t b) const { return b + 1 < bands.size() ? BAND_ROWS : height - b * BAND_ROWS; }
+    word_t* band_data(size_t b) {
+        unstamp();
+        if (bands[b].use_count() != 1) unshare(b);
+        // the other owners may just have let go; see their writes before ours
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return bands[b]->data();
+    }
+    void unshare(size_t b);
+    // gives the contents a new epoch
+    void stamp();
+    // the contents are about to change; workers writing rows at once all get here
+    void unstamp() {
+        if (get_epoch() != 0) epoch.value.store(0, std::memory_order_relaxed);
+    }
+
+    // an atomic that copies, so that Grid keeps its implicit copies and moves
+    struct Epoch {
+        std::atomic<uint64_t> value{0};
+        Epoch() = default;
+        Epoch(const Epoch& o): value(o.value.load(std::memory_order_relaxed)) {}
+        Epoch& operator=(const Epoch& o) {
+            value.store(o.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
     size_t width;
     size_t height;
-    std::vector<std::vector<bool>> grid;
+    size_t stride; // words per row, including padding
+    Rule rule;
+    std::vector<std::shared_ptr<Band>> bands;
+    Epoch epoch;
+};
+
+// A read-only window onto packed rows someone else owns: a Grid, a part of
+// one, or rows laid out like a Grid's elsewhere, such as a mapped file. It is a
+// few pointers and sizes, so it is passed by value, and it is valid as long as
+// the rows are; a view of a grid does not survive writes to the grid. Cell x of
+// the view is bit x + get_x0() of its row words.
+class GridView {
+public:
+    using word_t = Grid::word_t;
+
+    GridView(const Grid& g)
+        : bands(g.bands.data()), rows(nullptr), stride(g.stride), x0(0), y0(0), width(g.width), height(g.height),
+          rule(g.rule), whole(true) {}
+    // h rows of w cells, stride words apart from rows on
+    GridView(const word_t* rows, size_t w, size_t h, size_t stride, const Rule& rule = rules::CONWAY)
+        : bands(nullptr), rows(rows), stride(stride), x0(0), y0(0), width(w), height(h), rule(rule), whole(false) {}
+
+    size_t get_width() const { return width; }
+    size_t get_height() const { return height; }
+    const Rule& get_rule() const { return rule; }
+    size_t get_stride() const { return stride; }
+    size_t get_x0() const { return x0; }
+
+    // the packed words of row y, starting with the one holding cell 0
+    const word_t* row(size_t y) const {
+        const size_t r = y0 + y;
+        const word_t* words = bands ? bands[r / Grid::BAND_ROWS]->data() + r % Grid::BAND_ROWS * stride
+                                    : rows + r * stride;
+        return words + x0 / Grid::WORD_BITS;
+    }
+    bool get_cell(size_t x, size_t y) const {
+        const size_t c = x0 % Grid::WORD_BITS + x;
+        return (row(y)[c / Grid::WORD_BITS] >> (c % Grid::WORD_BITS)) & 1;
+    }
+    // calls f(x) for every live cell of row y, left to right
+    template <class F> void for_each_live(size_t y, F f) const {
+        const size_t begin = x0 % Grid::WORD_BITS;
+        const size_t end = begin + width;
+        const word_t* words = row(y);
+        const size_t last = (end - 1) / Grid::WORD_BITS;
+        for (size_t i = 0; width && i <= last; ++i) {
+            i = skip_zeros(words, i, last);
+            for (word_t w = bits(words, i, begin, end); w; w &= w - 1) {
+                f(i * Grid::WORD_BITS + count_trailing_zeros(w) - begin);
+            }
+        }
+    }
+    // calls f(begin, end) for every run of live cells begin up to end of row y,
+    // left to right; a run's ends are found a word at a time with ctz, so a
+    // long run costs no more than a short one
+    template <class F> void for_each_run(size_t y, F f) const {
+        const size_t begin = x0 % Grid::WORD_BITS;
+        const size_t end = begin + width;
+        const word_t* words = row(y);
+        const size_t last = (end - 1) / Grid::WORD_BITS;
+        size_t start = SIZE_MAX; // of a run going on past the last word
+        for (size_t i = 0; width && i <= last; ++i) {
+            if (start == SIZE_MAX) i = skip_zeros(words, i, last);
+            const size_t base = i * Grid::WORD_BITS;
+            word_t w = bits(words, i, begin, end);
+            if (start != SIZE_MAX) {
+                if (w == ~word_t(0)) continue;
+                const size_t stop = count_trailing_zeros(~w);
+                f(start - begin, base + stop - begin);
+                start = SIZE_MAX;
+                w &= ~word_t(0) << stop;
+            }
+            while (w) {
+                const size_t first = count_trailing_zeros(w);
+                const word_t dead = ~w & (~word_t(0) << first);
+                if (!dead) {
+                    start = base + first;
+                    break;
+                }
+                const size_t stop = count_trailing_zeros(dead);
+                f(base + first - begin, base + stop - begin);
+                w &= ~word_t(0) << stop;
+            }
+        }
+        if (start != SIZE_MAX) {
+            f(start - begin, width);
+        }
+    }
+
+    // w x h cells from (x, y) on, sharing the rows
+    GridView window(size_t x, size_t y, size_t w, size_t h) const;
+    // the smallest window holding every live cell, empty without any
+    GridView minimal() const;
+    size_t population() const;
+
+private:
+    friend class Grid;
+
+    // the first of words i up to last that may be nonzero, passing over zero
+    // cache lines a test each, so empty stretches of a sparse board go quickly
+    static size_t skip_zeros(const word_t* words, size_t i, size_t last) {
+        while (i + Grid::ROW_ALIGN <= last) {
+            word_t any = 0;
+            for (size_t k = 0; k < Grid::ROW_ALIGN; ++k) any |= words[i + k];
+            if (any) break;
+            i += Grid::ROW_ALIGN;
+        }
+        return i;
+    }
+    // the cells of word i of row y at or past begin and before end, counted
+    // from the start of the row words
+    word_t bits(const word_t* words, size_t i, size_t begin, size_t end) const {
+        word_t w = words[i];
+        if (i == begin / Grid::WORD_BITS) w &= ~word_t(0) << (begin % Grid::WORD_BITS);
+        if ((i + 1) * Grid::WORD_BITS > end) w &= (word_t(1) << (end % Grid::WORD_BITS)) - 1;
+        return w;
+    }
+
+    const std::shared_ptr<Grid::Band>* bands; // of a Grid, else null
+    const word_t* rows;                       // of other memory, else null
+    size_t stride;
+    size_t x0;
+    size_t y0;
+    size_t width;
+    size_t height;
+    Rule rule;
+    bool whole; // all of a Grid
+};
+
+// Size and layout report of a History.
+struct HistoryStats {
+    size_t entries = 0;
+    size_t keyframes = 0;
+    size_t dropped = 0;     // entries only kept as the generation they are after
+    size_t spacing = 0;     // entries between checkpoints since the budget was hit, else 0
+    uint64_t bytes = 0;     // encoded size of all entries and their bookkeeping
+    uint64_t raw_bytes = 0; // what a full grid per entry would take
+    uint64_t budget = 0;    // 0 for none
+    // seeks to an earlier entry, and the generations they had to recompute
+    uint64_t backward_seeks = 0;
+    uint64_t backward_recomputed = 0;
+    double backward_seconds = 0;
+};
+
+// A sequence of same-sized grids stored compactly. Most entries are the XOR of
+// a grid with the one before it, in which consecutive generations are almost all
+// zero; every `interval` entries, and wherever the caller asks, a keyframe holds
+// a whole grid instead. Both are run-length encoded by words: a count of zero
+// words, a count of literal words, the literal words, and so on.
+//
+// A grid is rebuilt from the nearest keyframe at or before it, or by walking
+// from a neighbouring entry one XOR at a time, whichever is shorter: since XOR
+// undoes itself, a delta takes a grid both forward and back.
+//
+// With a byte budget, exceeding it thins the history out to checkpoints: every
+// `spacing` entries becomes a keyframe and the entries between them are dropped,
+// the spacing doubling until the history fits in half the budget. A dropped
+// entry is recomputed from the one before it with the caller's step function,
+// so only entries one generation after their predecessor may be dropped; those
+// pushed as not derived (edits, jumps) are always kept. Recomputed entries are
+// stored again as deltas while they fit in the budget. The budget counts each
+// entry's bookkeeping too, so a history thinned to its first entry and the
+// pinned ones can still be over it; evict() then drops the oldest entries up to
+// a keyframe, and failing that the newest, so that only one keyframe is ever
+// kept above the budget.
+class History {
+public:
+    static constexpr size_t DEFAULT_INTERVAL = 64;
+    // computes the entry after src into out
+    using StepFn = std::function<void(const Grid& src, Grid& out)>;
+
+    explicit History(size_t interval = DEFAULT_INTERVAL): interval(interval ? interval : 1) {}
+
+    size_t size() const { return entries.size(); }
+    void clear();
+    // keeps the first n entries
+    void truncate(size_t n);
+    // appends g as a keyframe that is never dropped
+    void push_keyframe(const Grid& g);
+    // appends g; prev must be the last entry, and g the generation after it
+    // unless derived is false
+    void push(const Grid& prev, const Grid& g, bool derived = true);
+
+    Grid get(size_t i, const StepFn& step);
+    // turns g, which holds entry `from`, into entry `to`
+    void seek(Grid& g, size_t from, size_t to, const StepFn& step);
+
+    size_t get_interval() const { return interval; }
+    // takes effect from the next entry on
+    void set_interval(size_t n) { interval = n ? n : 1; }
+    uint64_t get_budget() const { return budget; }
+    // 0 lifts the budget; it is applied by the next fit()
+    void set_budget(uint64_t bytes) { budget = bytes; }
+    // thins the history out if it is over budget; true if it did
+    bool fit(const StepFn& step);
+    // Drops what fit() could not thin away: the oldest entries, entry keep
+    // becoming a keyframe if need be, then those after keep. Returns how many
+    // of the oldest it dropped, by which later entries move down.
+    size_t evict(size_t keep, const StepFn& step);
+    // entries kept as keyframes
+    std::vector<size_t> checkpoints() const;
+    HistoryStats stats() const;
+
+private:
+    struct Entry {
+        std::vector<uint8_t> data;
+        bool keyframe;
+        bool pinned;  // not derived from the entry before
+        bool dropped; // data empty, recomputed on demand
+        Rule rule;
+    };
+
+    // bytes e takes in the budget
+    static uint64_t footprint(const Entry& e) { return sizeof(Entry) + e.data.size(); }
+    void append(Entry e);
+    void store(size_t i, std::vector<uint8_t> data, bool keyframe);
+    // index of the last keyframe at or before i
+    size_t keyframe_before(size_t i) const;
+    // Turns g, holding entry i-1, into entry i (any g for a keyframe), with back
+    // as scratch. True if it was recomputed, and then stored again if restore is
+    // set and it fits the budget.
+    bool forward(Grid& g, Grid& back, size_t i, const StepFn& step, bool restore);
+    // keeps keyframes every `every` entries and the pinned ones, dropping the rest
+    void thin(size_t every, const StepFn& step);
+
+    size_t interval;
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<Entry> entries;
+    uint64_t bytes = 0;
+    uint64_t budget = 0;
+    size_t spacing = 0;
+    uint64_t backward_seeks = 0;
+    uint64_t backward_recomputed = 0;
+    double backward_seconds = 0;
 };
 
 class Simulation {
 public:
-    Simulation(): tick(0), delay(300) { states.push_back(Grid(20, 20)); }
-    Simulation(int w, int h): tick(0), delay(300) { states.push_back(Grid(w, h)); }
-    Simulation(Grid g): tick(0), delay(300) { states.push_back(g); }
+    Simulation(): Simulation(Grid(20, 20)) {}
+    Simulation(int w, int h): Simulation(Grid(w, h)) {}
+    Simulation(Grid g): tick(0), delay(300), engine(Engine::Bitsliced), advance_mode(AdvanceMode::Step),
+                        grid(g), history(true), edited(false), spare(0, 0), frontier(0, 0), frontier_at(SIZE_MAX),
+                        schedule(Schedule::Strips), processes(2), step_allocations(0), steps(0) {
+        log.push_keyframe(grid);
+        generations.push_back(0);
+    }
 
-    void random() { states[tick].random(); }
+    void random() {
+        grid.random();
+        tiles.invalidate();
+        edit();
+    }
 
     size_t get_tick() const { return tick; }
+    // generations since the start; differs from the tick once advance() jumped ahead
+    uint64_t get_generation() const { return generations[tick]; }
     int get_delay() const { return delay; }
-    size_t get_width() const { return states[tick].get_width(); }
-    size_t get_height() const { return states[tick].get_height(); }
-    bool get_cell(size_t x, size_t y) { return states[tick].get_cell(x, y); }
+    Engine get_engine() const { return engine; }
+    AdvanceMode get_advance_mode() const { return advance_mode; }
+    bool get_history() const { return history; }
+    size_t get_threads() const;
+    Schedule get_schedule() const { return schedule; }
+    size_t get_processes() const { return processes; }
+    // the scheduler of Schedule::WorkStealing with the statistics of its last run, else null
+    const WorkStealingScheduler* get_scheduler() const { return scheduler.get(); }
+    const TileActivity& get_tile_activity() const { return tiles; }
+    const TemporalBlocking& get_blocking() const { return blocking; }
+    const Wavefront& get_wavefront() const { return wavefront; }
+    // grid buffers allocated by step(), next() and advance(), and the generations they made
+    uint64_t get_step_allocations() const { return step_allocations; }
+    uint64_t get_steps() const { return steps; }
+    // size of the kept generations, compressed and as full grids
+    HistoryStats get_history_stats() const { return log.stats(); }
+    size_t get_width() const { return grid.get_width(); }
+    size_t get_height() const { return grid.get_height(); }
+    bool get_cell(size_t x, size_t y) { return grid.get_cell(x, y); }
+    const Rule& get_rule() const { return grid.get_rule(); }
     
     void set_delay(int val) { delay = val; }
+    void set_engine(Engine e) { engine = e; }
+    void set_advance_mode(AdvanceMode mode) { advance_mode = mode; }
+    // Stepping ping-pongs between the current generation and one spare grid,
+    // allocating nothing. With history every generation is also kept in a
+    // History; without it only the current one is.
+    void set_history(bool keep);
+    // generations between two keyframes of the history, see History
+    void set_keyframe_interval(size_t n) { log.set_interval(n); }
+    // Caps the history at this many bytes, 0 for no cap: past it, only
+    // checkpoints are kept and prev() recomputes forward from the nearest one,
+    // and once those are over it too the oldest generations are forgotten, so
+    // that reset() goes back to the oldest one left. A cap below one grid keeps
+    // just the current generation. get_history_stats() reports the layout and
+    // what backward steps cost.
+    void set_history_budget(uint64_t bytes) {
+        commit();
+        log.set_budget(bytes);
+        fit_history();
+    }
+    std::vector<size_t> get_checkpoints() const { return log.checkpoints(); }
+    // Steps on a persistent pool of n threads (0: one per hardware thread), each
+    // optionally pinned to a CPU; 1 steps on the calling thread unless work
+    // stealing is asked for. Work stealing only applies to the bitsliced engine.
+    void set_threads(size_t n, bool pin = false, Schedule s = Schedule::Strips);
+    // ranks AdvanceMode::Processes splits the board over, at most one per row
+    void set_processes(size_t n) { processes = n; }
+    void set_blocking(size_t tile_rows, size_t depth) {
+        blocking.tile_rows = tile_rows;
+        blocking.depth = depth;
+    }
+    // AdvanceMode::Wavefront runs on the strip pool of set_threads(); with
+    // barrier set it synchronises every generation instead, for comparison
+    void set_wavefront_barrier(bool barrier) { wavefront.barrier = barrier; }
     void set_cell(size_t x, size_t y, bool state) {
-        states[tick].set_cell(x, y, state);
-        states.erase(states.begin()+tick+1, states.end());
+        const bool mapped = tiles.describes(grid);
+        grid.set_cell(x, y, state);
+        if (mapped) tiles.touch(grid, x, y);
+        edit();
+    }
+    // applies from the current generation on; later history was computed with the old rule
+    void set_rule(const Rule& rule) {
+        grid.set_rule(rule);
+        tiles.invalidate();
+        edit();
     }
 
-    void display() const { states[tick].display(); };
+    void display() const { grid.display(); };
 
     Grid reset();
     Grid prev();
     Grid next();
     Grid cur();
+    // same as next() without returning a copy; moves to the next generation
+    // without computing it when the history already holds it
+    void step();
+    // Computes the generation after the newest one in the history without
+    // moving to it, so that stepping there later is free. Edits and rule changes
+    // drop it with the rest of the future. False, doing nothing, without history
+    // or when the history jumped ahead with advance().
+    bool precompute();
+    // generations right after the current one that step() will not have to compute
+    size_t get_precomputed() const;
+    const Grid& current() const { return grid; }
+    // the current generation without copying it, until the simulation changes
+    GridView view() const { return grid; }
+    // jumps n generations ahead as a single history entry
+    Grid advance(uint64_t n);
 private:
+    // one generation of src into out with the engine and threads set up
+    void step_grid(const Grid& src, Grid& out);
+    // the current generation changed: drops the future, and the history entry is
+    // rewritten by commit() before the history is used again
+    void edit() {
+        edited = true;
+        drop_future();
+    }
+    void commit();
+    void drop_future();
+    // steps dropped history entries back into existence
+    History::StepFn recompute();
+    // applies the history budget
+    void fit_history();
+    // sizes the spare grid to the current one
+    Grid& back_buffer();
+
     size_t tick;
     int delay; // ms
-    std::vector<Grid> states;
+    Engine engine;
+    AdvanceMode advance_mode;
+    TemporalBlocking blocking;
+    Wavefront wavefront;
+    Grid grid; // the current generation
+    History log; // every generation kept, when history is on
+    std::vector<uint64_t> generations; // of each entry of log, or of grid alone
+    bool history;
+    bool edited; // grid differs from its entry in log
+    Grid spare; // back buffer
+    Grid frontier; // the newest entry of log, for precompute()
+    size_t frontier_at; // entry of log frontier holds, stale unless newest
+    std::shared_ptr<ThreadPool> pool; // null when single-threaded
+    Schedule schedule;
+    std::shared_ptr<WorkStealingScheduler> scheduler; // set for Schedule::WorkStealing
+    // the universe of AdvanceMode::HashLife, kept with its memoized results
+    // until the rule changes; the board's size never does
+    std::shared_ptr<HashLife> hashlife;
+    TileActivity tiles;
+    size_t processes;
+    uint64_t step_allocations;
+    uint64_t steps;
 };
 
 #endif /* CGOL_HPP */
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef CGOL_DOMAIN_HPP
+#define CGOL_DOMAIN_HPP
+
+#include "cgol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Domain decomposition: one logical grid is cut into horizontal slabs, each
+// owned by one rank (a process), and every generation the ranks trade the one
+// row on each side of their slab that their neighbours need. The torus wraps,
+// so the first and last ranks are neighbours too.
+
+// Moves the edge rows between ranks. Ranks are numbered 0..ranks()-1 from the
+// top of the board; the rank above r is r-1 and the one below r+1, wrapping.
+// Implementations only have to deliver rows in generation order, so the same
+// stepping code runs over shared memory, sockets or a network.
+class HaloTransport {
+public:
+    virtual ~HaloTransport() = default;
+
+    virtual size_t rank() const = 0;
+    virtual size_t ranks() const = 0;
+    // publishes the first and last row of this rank's slab at generation gen
+    virtual void send_edges(uint64_t gen, const Grid::word_t* top, const Grid::word_t* bottom) = 0;
+    // waits for the rows just above and just below the slab at generation gen
+    virtual void receive_halos(uint64_t gen, Grid::word_t* above, Grid::word_t* below) = 0;
+};
+
+// first row rank r of n owns on a board of the given height; it owns the rows
+// up to the first row of rank r+1
+inline size_t slab_begin(size_t height, size_t r, size_t n) { return height * r / n; }
+
+// Advances one slab n generations, trading halos over the transport each
+// generation. Every rank of the transport has to run it with the same n.
+Grid step_slab(const Grid& slab, uint64_t n, HaloTransport& transport);
+
+// Transport over a POSIX shared memory segment. Each rank has two mailboxes,
+// one per generation parity, holding its edge rows, and a published generation
+// counter; a rank fills the mailbox of the current parity, bumps its counter and
+// spins until both neighbours have bumped theirs. A mailbox is only refilled
+// two generations later, after both neighbours have read it. The segment also
+// holds the whole board for scattering the start and gathering the result.
+class ShmTransport: public HaloTransport {
+public:
+    // Creates the segment for a board of g's size split over the given number of
+    // ranks, and scatters g into it.
+    static void create(const std::string& name, const Grid& g, size_t ranks);
+    // removes the segment's name; mappings stay valid until released
+    static void unlink(const std::string& name);
+
+    // maps an existing segment as the given rank
+    ShmTransport(const std::string& name, size_t rank);
+    ~ShmTransport() override;
+    ShmTransport(const ShmTransport&) = delete;
+    ShmTransport& operator=(const ShmTransport&) = delete;
+
+    size_t rank() const override { return own; }
+    size_t ranks() const override;
+    void send_edges(uint64_t gen, const Grid::word_t* top, const Grid::word_t* bottom) override;
+    void receive_halos(uint64_t gen, Grid::word_t* above, Grid::word_t* below) override;
+    // receive_halos() that returns false instead of throwing when the run was
+    // aborted; it never allocates, for ranks forked from a threaded process
+    bool try_receive_halos(uint64_t gen, Grid::word_t* above, Grid::word_t* below);
+
+    // this rank's slab of the shared board
+    Grid read_slab() const;
+    // writes this rank's rows of the board from rows first on of slab
+    void write_slab(const Grid& slab, size_t first = 0);
+    // the whole shared board, complete once every rank wrote its slab
+    Grid gather() const;
+    // makes every rank still waiting for a halo give up with an exception
+    void abort();
+
+private:
+    struct Header;
+
+    Grid::word_t* mailbox(size_t rank, uint64_t gen, int edge) const;
+    Grid::word_t* board_row(size_t y) const;
+    // false when the run was aborted first
+    bool wait_for(size_t rank, uint64_t gen) const;
+
+    Header* header;
+    size_t bytes;
+    size_t own;
+};
+
+// Launcher: forks `processes` ranks that advance g n generations over a shared
+// memory segment, waits for them and gathers the board. Safe to call with other
+// threads running: the ranks' buffers are allocated before forking, and only
+// the ranks' own processes are reaped. POSIX only.
+Grid advance_processes(const Grid& g, uint64_t n, size_t processes);
+
+#endif /* CGOL_DOMAIN_HPP */
@@ -0,0 +1,70 @@
+#ifndef CGOL_ENSEMBLE_HPP
+#define CGOL_ENSEMBLE_HPP
+
+#include "cgol.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Many independent universes of the same size and rule, stepped together. The
+// universes are bit-sliced: 64 of them form a block, and word (x, y) of a block
+// holds cell (x, y) of all 64, universe u of the block in bit u. One kernel pass
+// over a block's w x h words then advances 64 universes, with vector kernels
+// handling several words per instruction, where separate Simulations would each
+// pay for their own rows, padding and bookkeeping.
+//
+// Universes are tori like Grid. Each one keeps its own generation count: it
+// starts over when the universe is replaced, and frozen universes keep both
+// their state and their count while the others step.
+class Ensemble {
+public:
+    static constexpr size_t LANES = 64;
+
+    Ensemble(size_t count, size_t w, size_t h, const Rule& rule = rules::CONWAY);
+
+    size_t size() const { return count; }
+    size_t get_width() const { return width; }
+    size_t get_height() const { return height; }
+    const Rule& get_rule() const { return rule; }
+
+    bool get_cell(size_t u, size_t x, size_t y) const { return (word(u / LANES, x, y) >> (u % LANES)) & 1; }
+    void set_cell(size_t u, size_t x, size_t y, bool state);
+
+    // replaces universe u with g, which must have the ensemble's size, and restarts its count
+    void set(size_t u, const GridView& g);
+    Grid get(size_t u) const;
+    // fills every universe at random and restarts all counts
+    void random();
+
+    // Frozen universes are skipped by step() and advance(). set(), get() and
+    // set_frozen() throw for a universe past the last one; the cell accessors
+    // do not check.
+    void set_frozen(size_t u, bool frozen);
+    bool is_frozen(size_t u) const { return (frozen[u / LANES] >> (u % LANES)) & 1; }
+
+    void step();
+    void advance(uint64_t n);
+
+    uint64_t get_generation(size_t u) const { return generations[u]; }
+    uint64_t population(size_t u) const;
+    // the population of every universe, counted for all lanes of a block at once
+    std::vector<uint64_t> populations() const;
+
+private:
+    using word_t = uint64_t;
+
+    void check(size_t u) const;
+    word_t& word(size_t block, size_t x, size_t y) { return cells[(block * height + y) * width + x]; }
+    word_t word(size_t block, size_t x, size_t y) const { return cells[(block * height + y) * width + x]; }
+
+    size_t count;
+    size_t width;
+    size_t height;
+    Rule rule;
+    std::vector<word_t, AlignedAllocator<word_t>> cells; // blocks of height rows of width words
+    std::vector<word_t, AlignedAllocator<word_t>> back;  // next generation
+    std::vector<word_t> frozen;  // per block, bit u set when universe u is frozen
+    std::vector<uint64_t> generations;
+};
+
+#endif /* CGOL_ENSEMBLE_HPP */
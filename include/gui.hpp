@@ -3,6 +3,7 @@
 
 #include "cgol.hpp"
 #include "parser_utils.hpp"
+#include "sim_runner.hpp"
 
 #include <QtWidgets>
 #include <QWizard>
@@ -16,11 +17,16 @@ public:
     SimWidget(QWidget *parent = nullptr, Grid g = Grid(20, 20));
     
     void replace(const Grid& g) {
-        int temp_delay = sim.get_delay();
-        sim = Simulation(g);
-        sim.set_delay(temp_delay);
+        runner.replace(g);
+        runner.sync();
+        update();
     }
 
+    // the newest generation the engine thread finished
+    const Grid& current() { return runner.frame().grid; }
+    size_t grid_width() { return current().get_width(); }
+    size_t grid_height() { return current().get_height(); }
+
     void create();
 
     void set_pencil();
@@ -38,13 +44,16 @@ protected:
     void mouseReleaseEvent(QMouseEvent* event) override;
 
 public slots:
-    void update_sim();
+    // repaints when the engine published a new frame
+    void refresh();
 
 private:
-    Simulation sim;
+    // the simulation runs on the runner's engine thread; this widget only
+    // queues edits and paints the frames it publishes
+    SimRunner runner;
     bool drawing = 0;
     bool tool = 1;
-    std::unique_ptr<QTimer> timer;
+    std::unique_ptr<QTimer> timer; // display refresh, independent of the simulation speed
 };
 
 class GridConfig: public QWizard {
@@ -97,14 +106,13 @@ public slots:
         simWidget->play();
     }
     void update_speed(int speed) {
-        simWidget->sim.set_delay(300 * (31-speed)/30);
-        simWidget->timer->setInterval(simWidget->sim.get_delay());
+        simWidget->runner.set_delay(300 * (31-speed)/30);
     }
 
 protected:
     void resizeEvent(QResizeEvent *event) override {
         QMainWindow::resizeEvent(event);
-        qreal aspectRatio = (qreal)simWidget->sim.get_width()/simWidget->sim.get_height();
+        qreal aspectRatio = (qreal)simWidget->grid_width()/simWidget->grid_height();
 
         QSize currentSize = event->size();
         int width = currentSize.width();
@@ -0,0 +1,116 @@
+#ifndef CGOL_HASHLIFE_HPP
+#define CGOL_HASHLIFE_HPP
+
+#include "cgol.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// HashLife: the universe is a quadtree whose nodes are canonicalized, so equal
+// squares share one node, and the future of every node is memoized. Regular
+// patterns can then be advanced by huge powers of two in a single step.
+// The plane is unbounded; coordinates are signed and the root is centered on 0.
+// Rules where empty space gives birth (B0) have no empty background and are rejected.
+class HashLife {
+public:
+    // a 2^level square; leaves (level 0) are single cells
+    struct Node {
+        const Node* nw;
+        const Node* ne;
+        const Node* sw;
+        const Node* se;
+        uint64_t population;
+        int level;
+        // memoized center after 2^result_step generations
+        mutable const Node* result;
+        mutable int result_step;
+    };
+
+    static constexpr int MAX_STEP = 60;
+
+    explicit HashLife(const Rule& rule = rules::CONWAY);
+    // places g with its top-left cell at (x, y) and runs it under g's rule
+    explicit HashLife(const GridView& g, int64_t x = 0, int64_t y = 0);
+    // nodes point at each other, so the universe can be moved but not copied
+    HashLife(const HashLife&) = delete;
+    HashLife& operator=(const HashLife&) = delete;
+    HashLife(HashLife&&) = default;
+    HashLife& operator=(HashLife&&) = default;
+
+    bool get_cell(int64_t x, int64_t y) const;
+    void set_cell(int64_t x, int64_t y, bool state);
+
+    // advances 2^k generations
+    void step(int k);
+    // advances 2^get_step() generations
+    void next() { step(step_log2); }
+    // advances n generations as a sum of power-of-two steps
+    void advance(uint64_t n);
+
+    int get_step() const { return step_log2; }
+    void set_step(int k);
+
+    uint64_t get_generation() const { return generation; }
+    uint64_t population() const { return root->population; }
+    const Rule& get_rule() const { return rule; }
+
+    // copies the w x h window with its top-left cell at (x, y)
+    Grid to_grid(int64_t x, int64_t y, size_t w, size_t h) const;
+
+    // Exact result of n generations of g as a torus, identical to calling
+    // get_next_state n times. The torus is unrolled into its periodic tiling
+    // of the plane, which HashLife then advances like any other pattern.
+    // Throws if g's rule is not the universe's rule.
+    Grid advance_torus(const Grid& g, uint64_t n);
+
+    size_t node_count() const { return nodes.size(); }
+    // garbage collection runs before a step once the node count passes this
+    void set_max_nodes(size_t n) { max_nodes = n; }
+    // drops every node and memoized result the current universe no longer uses
+    void collect_garbage();
+
+private:
+    struct Key {
+        const Node* nw;
+        const Node* ne;
+        const Node* sw;
+        const Node* se;
+        bool operator==(const Key& o) const { return nw == o.nw && ne == o.ne && sw == o.sw && se == o.se; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const;
+    };
+
+    const Node* leaf(bool alive) const { return leaves[alive]; }
+    const Node* join(const Node* nw, const Node* ne, const Node* sw, const Node* se);
+    const Node* empty(int level);
+
+    const Node* center(const Node* n);
+    const Node* horizontal(const Node* w, const Node* e);
+    const Node* vertical(const Node* n, const Node* s);
+    const Node* expand(const Node* n);
+    bool is_padded(const Node* n) const;
+
+    const Node* result(const Node* n, int j);
+    const Node* base_result(const Node* n);
+
+    const Node* set(const Node* n, int64_t ox, int64_t oy, int64_t x, int64_t y, bool state);
+    const Node* build(const GridView& g, int level, int64_t ox, int64_t oy, int64_t x, int64_t y);
+    void fill(const Node* n, int64_t ox, int64_t oy, Grid& g, int64_t x, int64_t y) const;
+    const Node* copy_into(const Node* n, HashLife& dst, std::unordered_map<const Node*, const Node*>& seen) const;
+
+    std::deque<Node> nodes;
+    std::unordered_map<Key, const Node*, KeyHash> table;
+    std::vector<const Node*> empties;
+    const Node* leaves[2];
+    const Node* root;
+
+    Rule rule;
+    uint64_t generation;
+    int step_log2;
+    size_t max_nodes;
+};
+
+#endif /* CGOL_HASHLIFE_HPP */
@@ -0,0 +1,62 @@
+#ifndef CGOL_KERNELS_HPP
+#define CGOL_KERNELS_HPP
+
+#include "rule.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kernels {
+
+using word_t = uint64_t;
+
+// Instruction sets the row kernel is built for, from slowest to fastest.
+enum class Isa { Scalar, SSE2, AVX2, AVX512 };
+
+using row_fn = void (*)(const word_t* up, const word_t* mid, const word_t* down, word_t* out,
+                        size_t width, size_t begin, size_t end, const Rule& rule);
+
+// Computes the next-generation words [begin, end) of one packed row from the rows
+// above (up), at (mid) and below (down) it under `rule`. Rows hold `width` cells
+// and wrap around horizontally; bits past the width come out cleared.
+// Runs the variant picked at startup: the fastest one the CPU supports, or the one
+// named by the CGOL_KERNEL environment variable (scalar, sse2, avx2, avx512).
+void step_row(const word_t* up, const word_t* mid, const word_t* down, word_t* out,
+              size_t width, size_t begin, size_t end, const Rule& rule = rules::CONWAY);
+
+// Steps one row of 64 universes at once: word x of a row holds cell x of every
+// universe, bit u belonging to universe u. Rows hold `width` cells and wrap around.
+using lane_fn = void (*)(const word_t* up, const word_t* mid, const word_t* down, word_t* out,
+                         size_t width, const Rule& rule);
+
+// The active variant's kernel for `rule`, to hoist the lookup out of row loops.
+// Conway, HighLife, Day & Night and Seeds get kernels specialized at compile time;
+// any other rule runs a generic kernel that tests the rule's counts at run time.
+row_fn row_kernel(const Rule& rule);
+lane_fn lane_kernel(const Rule& rule);
+
+Isa active_isa();
+const char* isa_name(Isa isa);
+// whether the variant was compiled in and the CPU can run it
+bool isa_supported(Isa isa);
+// switches the variant used by step_row; throws if it is not supported
+void set_isa(Isa isa);
+
+// The rule policies every variant is instantiated with: one compiled for each
+// rule with a dedicated kernel, and one reading the rule at run time.
+enum class RuleKernel { Conway, HighLife, DayAndNight, Seeds, Generic };
+RuleKernel rule_kernel(const Rule& rule);
+
+// per-variant entry points, nullptr when not compiled into this binary
+row_fn scalar_kernel(RuleKernel rule);
+row_fn sse2_kernel(RuleKernel rule);
+row_fn avx2_kernel(RuleKernel rule);
+row_fn avx512_kernel(RuleKernel rule);
+lane_fn scalar_lane_kernel(RuleKernel rule);
+lane_fn sse2_lane_kernel(RuleKernel rule);
+lane_fn avx2_lane_kernel(RuleKernel rule);
+lane_fn avx512_lane_kernel(RuleKernel rule);
+
+} // namespace kernels
+
+#endif /* CGOL_KERNELS_HPP */
@@ -0,0 +1,99 @@
+#ifndef CGOL_MAPPED_HPP
+#define CGOL_MAPPED_HPP
+
+#include "cgol.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// I/O of the last MappedGrid::advance. Dividing by generations gives the
+// traffic of one generation, which is what storage has to sustain.
+struct MappedStats {
+    uint64_t generations = 0;   // completed
+    uint64_t rows = 0;          // computed, including those of a generation left unfinished
+    uint64_t checkpoints = 0;   // progress made durable
+    uint64_t bytes_read = 0;    // rows streamed in from the mapped board
+    uint64_t bytes_written = 0; // rows written out to the other board
+    // what the OS counted the process reading from and writing to storage,
+    // less than the above while the board fits in the page cache
+    uint64_t disk_read_bytes = 0;
+    uint64_t disk_written_bytes = 0;
+    double seconds = 0;
+    double sync_seconds = 0; // of it, waiting for checkpoints to reach storage
+};
+
+// A board too large for memory, kept in a file: a header page and two boards of
+// packed rows laid out like Grid's, one holding the current generation and the
+// other the next one while it is computed. The current board is memory-mapped
+// and streamed through in row order with a window of three rows, the rows below
+// read ahead and the rows above dropped from the mapping with madvise; the next
+// generation is written with plain writes, which unlike stores to a mapping do
+// not read every page in first. A 1M x 1M board takes 2 x 125 GB.
+//
+// Every checkpoint_rows rows the written rows are synced and the header records
+// how many there are, so a run interrupted by a stop request or a crash resumes
+// at the last checkpoint, from the same generation, when the file is opened again.
+// POSIX only.
+class MappedGrid {
+public:
+    // checkpoints about this far apart when the rows are not set
+    static constexpr size_t DEFAULT_CHECKPOINT_BYTES = size_t(64) << 20;
+
+    // creates a file holding an empty board; fails if the path exists
+    static void create(const std::string& path, size_t w, size_t h, const Rule& rule = rules::CONWAY);
+    // creates a file holding g
+    static void create(const std::string& path, const GridView& g);
+
+    explicit MappedGrid(const std::string& path);
+    ~MappedGrid();
+    MappedGrid(const MappedGrid&) = delete;
+    MappedGrid& operator=(const MappedGrid&) = delete;
+
+    size_t get_width() const;
+    size_t get_height() const;
+    Rule get_rule() const;
+    // of the current board
+    uint64_t get_generation() const;
+    // rows of the next generation an interrupted advance already wrote
+    size_t get_rows_done() const;
+
+    bool get_cell(size_t x, size_t y) const;
+    // edits the current board, throwing away a half-done next generation;
+    // durable after sync()
+    void set_cell(size_t x, size_t y, bool state);
+    // rows y0 up to y0 + rows of the current board
+    Grid read_rows(size_t y0, size_t rows) const;
+    // the current board in place, paged in as it is read; valid until the
+    // next advance() or until this is closed
+    GridView view() const;
+    void sync();
+
+    // rows between checkpoints, 0 for about DEFAULT_CHECKPOINT_BYTES
+    void set_checkpoint_rows(size_t rows) { checkpoint_rows = rows; }
+    // Advances up to n generations, carrying on with an unfinished one first.
+    // When stop is set at a checkpoint it returns early, without finishing the
+    // generation under way. Returns the generations completed.
+    uint64_t advance(uint64_t n, const std::atomic<bool>* stop = nullptr);
+    const MappedStats& get_stats() const { return stats; }
+
+private:
+    struct Header;
+
+    // false when stopped before the end
+    bool step(const std::atomic<bool>* stop);
+    // makes the header durable
+    void write_header();
+    const Grid::word_t* board(uint64_t i) const;
+    uint64_t board_offset(uint64_t i) const;
+
+    int fd;
+    char* map;
+    size_t bytes;
+    Header* header; // the first page of the mapping
+    size_t checkpoint_rows;
+    MappedStats stats;
+};
+
+#endif /* CGOL_MAPPED_HPP */
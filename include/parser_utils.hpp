@@ -6,6 +6,7 @@
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <string_view>
 
 class Parser {
 public:
@@ -13,7 +14,7 @@ public:
     virtual ~Parser() {};
 
     virtual Grid read() = 0;
-    virtual void save(const Grid& g) = 0;
+    virtual void save(const GridView& g) = 0;
 
 protected:
     std::iostream& ios;
@@ -24,13 +25,47 @@ class RLE_Parser: public Parser {
 public:
     RLE_Parser(std::iostream& stream): Parser(stream) {}
     Grid read() override;
-    void save(const Grid& g) override;
+    void save(const GridView& g) override;
+    // a whole file already in memory
+    static Grid parse(std::string_view text);
 
     static const char COMMENT_TAG = '#';
     static const char DEAD_TAG = 'b';
     static const char LIVE_TAG = 'o';
     static const char EOL_TAG = '$';
     static const char END_TAG = '!';
+
+    // bytes of the pattern read at a time
+    static const size_t READ_CHUNK = 1 << 16;
+    // columns saved lines are kept within, as the format asks
+    static constexpr size_t LINE_WIDTH = 70;
+};
+
+// Decodes the cells of an RLE pattern into a grid, fed in pieces of any size.
+// A run of live cells is set a word at a time and a dead run only moves the
+// position, so the cost follows the tokens rather than the cells; besides the
+// grid only the run count under way is kept. Cells outside the grid are dropped.
+class RLE_Decoder {
+public:
+    explicit RLE_Decoder(Grid& g): grid(g) {}
+
+    // decodes the next n bytes; false once the end tag was seen
+    bool feed(const char* data, size_t n);
+    bool finished() const { return done; }
+
+private:
+    // longer runs than this are clipped by any grid there is
+    static constexpr uint64_t MAX_RUN = uint64_t(1) << 40;
+
+    // sets cells begin up to end of row
+    static void fill(Grid::word_t* row, size_t begin, size_t end);
+
+    Grid& grid;
+    uint64_t x = 0;
+    uint64_t y = 0;
+    uint64_t run = 0;             // digits read so far, 0 for none
+    Grid::word_t* row = nullptr; // row y once written to
+    bool done = false;
 };
 
 // https://conwaylife.com/wiki/Plaintext
@@ -38,7 +73,8 @@ class Plaintext_Parser: public Parser {
 public:
     Plaintext_Parser(std::iostream& stream): Parser(stream) {}
     Grid read() override;
-    void save(const Grid& g) override;
+    void save(const GridView& g) override;
+    static Grid parse(std::string_view text);
 
     static const char DEAD_SYMBOL = '.';
     static const char LIVE_SYMBOL = 'O';
@@ -50,15 +86,21 @@ class Life106_Parser: public Parser {
 public:
     Life106_Parser(std::iostream& stream): Parser(stream) {}
     Grid read() override;
-    void save(const Grid& g) override;
+    void save(const GridView& g) override;
+    static Grid parse(std::string_view text);
 };
 
 class FileHandler {
 public:
     FileHandler() {};
 
+    // Maps the file read-only where the OS supports it and parses the mapped
+    // bytes in place, so loading a large pattern costs a pass over its pages
+    // rather than a stream read and a string per line.
     Grid read(std::string filename);
-    void save(const Grid& g, std::string filename);
+    // the pattern in a file centered on an empty w x h board, under its rule
+    Grid read_centered(std::string filename, size_t w, size_t h);
+    void save(const GridView& g, std::string filename);
 
     std::string get_extension(std::string filename);
     // std::unique_ptr<Parser> get_parser(std::string filename);
@@ -0,0 +1,35 @@
+#ifndef CGOL_RULE_HPP
+#define CGOL_RULE_HPP
+
+#include <cstdint>
+#include <string>
+
+// Outer-totalistic rule: bit k of birth (survival) is set when a dead (live)
+// cell with k live neighbours is live in the next generation.
+struct Rule {
+    uint16_t birth;
+    uint16_t survival;
+
+    // "B3/S23" (any case or order) or the older survival/birth form "23/3"
+    static Rule parse(const std::string& text);
+    // canonical "B3/S23" form
+    std::string to_string() const;
+
+    bool next(bool alive, int neighbors) const { return ((alive ? survival : birth) >> neighbors) & 1; }
+    // whether empty space comes to life, which unbounded universes cannot represent
+    bool births_from_nothing() const { return birth & 1; }
+
+    bool operator==(const Rule& o) const { return birth == o.birth && survival == o.survival; }
+    bool operator!=(const Rule& o) const { return !(*this == o); }
+};
+
+// Rules with a dedicated kernel, see kernels::row_kernel.
+namespace rules {
+constexpr Rule CONWAY{1 << 3, (1 << 2) | (1 << 3)};                                              // B3/S23
+constexpr Rule HIGHLIFE{(1 << 3) | (1 << 6), (1 << 2) | (1 << 3)};                               // B36/S23
+constexpr Rule DAY_AND_NIGHT{(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8),
+                             (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8)};             // B3678/S34678
+constexpr Rule SEEDS{1 << 2, 0};                                                                 // B2/S
+} // namespace rules
+
+#endif /* CGOL_RULE_HPP */
@@ -0,0 +1,59 @@
+#ifndef CGOL_SCHEDULER_HPP
+#define CGOL_SCHEDULER_HPP
+
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs a batch of independent tasks on a persistent pool with one deque per
+// worker. Each worker starts with a contiguous share of the tasks and takes
+// them from the front of its own deque; once that is empty it steals from the
+// back of the others', so workers that drew cheap tasks help out the ones
+// stuck with expensive ones instead of idling.
+class WorkStealingScheduler {
+public:
+    // what one worker did during the last run()
+    struct WorkerStats {
+        uint64_t tasks;      // tasks run, own and stolen
+        uint64_t steals;     // tasks taken from another worker's deque
+        double busy_seconds; // time spent inside tasks
+    };
+
+    // 0 threads uses one per hardware thread, pin as for ThreadPool
+    explicit WorkStealingScheduler(size_t threads = 0, bool pin = false);
+
+    size_t size() const { return pool.size(); }
+
+    // Calls fn(task, worker) once for every task in [0, tasks) and waits for all
+    // of them. Which worker runs a task varies from run to run, so tasks must
+    // not depend on it for their result. Concurrent calls are serialized.
+    void run(size_t tasks, const std::function<void(size_t task, size_t worker)>& fn);
+
+    const std::vector<WorkerStats>& last_stats() const { return stats; }
+    double last_seconds() const { return seconds; }
+    // share of the last run's wall time worker i spent inside tasks
+    double utilization(size_t worker) const;
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    bool pop(size_t worker, size_t& task);
+    bool steal(size_t thief, size_t& task);
+
+    std::mutex running; // one batch at a time
+    ThreadPool pool;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<WorkerStats> stats;
+    double seconds;
+};
+
+#endif /* CGOL_SCHEDULER_HPP */
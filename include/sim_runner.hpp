@@ -0,0 +1,92 @@
+#ifndef CGOL_SIM_RUNNER_HPP
+#define CGOL_SIM_RUNNER_HPP
+
+#include "cgol.hpp"
+#include "triple_buffer.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Owns a Simulation and runs it on its own engine thread, so a slow generation
+// never blocks the thread that displays it. Edits and playback controls are
+// queued and applied by the engine in order; every finished generation (and
+// every applied batch of edits) is published as a Frame through a triple
+// buffer, which the display thread reads without locking.
+//
+// Whenever it has nothing else to do, paused or between two timed steps, the
+// engine computes up to get_lookahead() generations ahead into the history, one
+// at a time, so next() and playback only have to move to them. An edit simply
+// drops them with the rest of the future; work already started on is finished
+// first, so a queued command waits at most one generation.
+class SimRunner {
+public:
+    static constexpr size_t DEFAULT_LOOKAHEAD = 8;
+
+    struct Frame {
+        Grid grid;
+        size_t tick;
+        uint64_t generation;
+    };
+
+    explicit SimRunner(Grid g);
+    // stops the engine thread, dropping commands it did not get to
+    ~SimRunner();
+    SimRunner(const SimRunner&) = delete;
+    SimRunner& operator=(const SimRunner&) = delete;
+
+    void set_cell(size_t x, size_t y, bool state);
+    void reset();
+    // steps back unless at the first generation
+    void prev();
+    void next();
+    // swaps in a new board, keeping the delay and playback state
+    void replace(const Grid& g);
+    // runs any other change on the engine thread
+    void post(std::function<void(Simulation&)> command);
+
+    // steps every get_delay() ms while playing
+    void play();
+    void pause();
+    bool is_playing() const { return playing; }
+    void set_delay(int ms);
+    int get_delay() const { return delay; }
+    // generations to precompute while idle, 0 to compute each on demand
+    void set_lookahead(size_t generations);
+    size_t get_lookahead() const { return lookahead; }
+
+    // Newest completed frame. Only ever call these from one thread, the display one;
+    // the frame stays valid until its next call to frame().
+    const Frame& frame() { return frames.read(); }
+    bool has_new_frame() const { return frames.fresh(); }
+
+    // waits until every command posted so far has run and its frame is published
+    void sync();
+
+private:
+    void run();
+    void publish();
+
+    Simulation sim; // touched by the engine thread only
+    TripleBuffer<Frame> frames;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::function<void(Simulation&)>> commands;
+    uint64_t posted;    // commands queued so far
+    uint64_t completed; // commands applied and published so far
+    bool restart;       // play() was called, the next step is due now
+    bool stopping;
+
+    std::atomic<bool> playing;
+    std::atomic<int> delay;
+    std::atomic<size_t> lookahead;
+    std::thread engine; // last, so it starts once everything else is set up
+};
+
+#endif /* CGOL_SIM_RUNNER_HPP */
@@ -0,0 +1,108 @@
+#ifndef CGOL_SPARSE_HPP
+#define CGOL_SPARSE_HPP
+
+#include "cgol.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// An unbounded universe addressed with 64-bit signed coordinates. Cells live in
+// 64x64 bit-packed tiles kept in a hash map, and only tiles holding live cells
+// (or bordering live edges) are stored, so memory follows the live area rather
+// than its bounding box.
+//
+// Like Golly's QuickLife, each tile remembers whether it changed over the last one
+// and the last two generations. A tile whose whole neighbourhood did not change
+// keeps its state without being computed, and one whose neighbourhood matches two
+// generations ago (a period-2 oscillator) flips back to its previous state. Only
+// tiles near recent changes are even visited, so the cost of a step follows the
+// activity rather than the area. Rules where empty space gives birth (B0) would
+// fill the whole plane and are rejected.
+class SparseUniverse {
+public:
+    static constexpr int TILE_SHIFT = 6;
+    static constexpr int64_t TILE_SIZE = int64_t(1) << TILE_SHIFT;
+
+    // row y of the tile is rows[y], column x is bit x
+    struct Tile {
+        uint64_t rows[TILE_SIZE];
+    };
+
+    // what the last step did with the stored tiles
+    struct StepStats {
+        size_t computed; // ran the kernel
+        size_t flipped;  // period 2, took back the state of two generations ago
+        size_t skipped;  // stable, left untouched
+    };
+
+    explicit SparseUniverse(const Rule& rule = rules::CONWAY);
+    // places g with its top-left cell at (x, y) and runs it under g's rule
+    explicit SparseUniverse(const GridView& g, int64_t x = 0, int64_t y = 0);
+
+    bool get_cell(int64_t x, int64_t y) const;
+    void set_cell(int64_t x, int64_t y, bool state);
+
+    void step();
+    void advance(uint64_t n);
+
+    uint64_t get_generation() const { return generation; }
+    const Rule& get_rule() const { return rule; }
+    uint64_t population() const;
+    size_t tile_count() const { return tiles.size(); }
+    size_t memory_bytes() const { return tiles.size() * sizeof(Slot); }
+    const StepStats& last_step() const { return stats; }
+
+    // inclusive bounding box of the live cells, false when there are none
+    bool bounds(int64_t& min_x, int64_t& min_y, int64_t& max_x, int64_t& max_y) const;
+    // copies the w x h window with its top-left cell at (x, y)
+    Grid to_grid(int64_t x, int64_t y, size_t w, size_t h) const;
+
+private:
+    struct Key {
+        int64_t x;
+        int64_t y;
+        bool operator==(const Key& o) const { return x == o.x && y == o.y; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return (uint64_t(k.x) * 0x9e3779b97f4a7c15ull) ^ (uint64_t(k.y) * 0xc2b2ae3d27d4eb4full);
+        }
+    };
+    // a tile with its last two generations
+    struct Slot {
+        Tile buf[2];
+        uint8_t cur;     // index of the current generation in buf
+        bool changed;    // differs from one generation ago
+        bool changed2;   // differs from two generations ago
+        bool edited;     // set_cell since the last step: buf[1-cur] no longer leads here
+        uint64_t stamp;  // last step that visited the tile
+
+        const Tile& now() const { return buf[cur]; }
+        bool active() const { return changed || changed2; }
+    };
+    using TileMap = std::unordered_map<Key, Slot, KeyHash>;
+
+    // tile coordinate of a cell coordinate, rounding toward negative infinity
+    static int64_t tile_of(int64_t v) { return v >> TILE_SHIFT; }
+    static size_t bit_of(int64_t v) { return size_t(v & (TILE_SIZE - 1)); }
+
+    const Slot* find(int64_t tx, int64_t ty) const;
+    Slot& insert(const Key& key);
+    bool step_tile(int64_t tx, int64_t ty, Tile& out) const;
+    bool edge_reaches(const Key& from, int dx, int dy) const;
+
+    // steps the rows of a tile from its columns with one row of halo
+    using TileKernel = uint64_t (*)(const uint64_t (*col)[TILE_SIZE+2], Tile& out, const Rule& rule);
+
+    TileMap tiles;
+    // tiles that changed within the last two generations
+    std::vector<Key> active;
+    Rule rule;
+    // specialized for the rule when it has a dedicated kernel, see kernels::row_kernel
+    TileKernel kernel;
+    uint64_t generation;
+    StepStats stats;
+};
+
+#endif /* CGOL_SPARSE_HPP */
@@ -0,0 +1,51 @@
+#ifndef CGOL_THREAD_POOL_HPP
+#define CGOL_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads started once and reused for every job, so a
+// generation costs a wake-up rather than a thread creation. run() hands the same
+// function to every worker together with its index and returns once all of them
+// are done; the calling thread takes part as worker 0.
+class ThreadPool {
+public:
+    // 0 threads uses one per hardware thread. With pin, worker i is bound to CPU
+    // i (Linux only, elsewhere it is ignored); the calling thread is left alone.
+    explicit ThreadPool(size_t threads = 0, bool pin = false);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+    bool is_pinned() const { return pinned; }
+
+    // Calls fn(i) for every worker i in [0, size()) and waits for all of them.
+    // The first exception thrown by a worker is rethrown here. Concurrent calls
+    // are serialized; calling run() from inside fn deadlocks.
+    void run(const std::function<void(size_t)>& fn);
+
+private:
+    void work(size_t id);
+
+    std::vector<std::thread> workers;
+    bool pinned;
+
+    std::mutex running; // one job at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* task;
+    uint64_t epoch;  // bumped for every job
+    size_t pending;  // workers still busy with the current job
+    bool stopping;
+    std::exception_ptr error;
+};
+
+#endif /* CGOL_THREAD_POOL_HPP */
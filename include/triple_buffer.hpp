@@ -0,0 +1,45 @@
+#ifndef CGOL_TRIPLE_BUFFER_HPP
+#define CGOL_TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one writer thread to one reader thread without locks or
+// waiting. The writer fills the back slot and publishes it, the reader takes
+// the newest published slot; the third slot sits between them, so neither side
+// ever touches the slot the other one is using. Values the reader did not get
+// to in time are simply skipped. Slots are reused, so a T that keeps its
+// capacity on assignment (like Grid) is handed over without allocating.
+template <class T>
+class TripleBuffer {
+public:
+    explicit TripleBuffer(const T& initial = T()): slots{initial, initial, initial}, middle(1), back(2), front(0) {}
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // writer: the slot to fill next
+    T& write() { return slots[back]; }
+    // writer: makes the filled slot the newest value and starts on another one
+    void publish() { back = middle.exchange(uint8_t(back | FRESH), std::memory_order_acq_rel) & INDEX; }
+
+    // reader: whether a value was published since the last read()
+    bool fresh() const { return middle.load(std::memory_order_acquire) & FRESH; }
+    // reader: the newest published value, valid until the next read()
+    const T& read() {
+        if (fresh()) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        }
+        return slots[front];
+    }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    T slots[3];
+    std::atomic<uint8_t> middle; // index of the middle slot, FRESH once published
+    uint8_t back;                // owned by the writer
+    uint8_t front;               // owned by the reader
+};
+
+#endif /* CGOL_TRIPLE_BUFFER_HPP */
@@ -0,0 +1,93 @@
+#include "cgol.hpp"
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// bytes a tile (rows plus both halos) may take to stay resident in L2
+constexpr size_t TILE_BYTES = 256 * 1024;
+
+} // namespace
+
+void Grid::advance_blocked(Grid& out, uint64_t n, TemporalBlocking& blocking) const {
+    if (out.width != width || out.height != height) {
+        throw std::runtime_error("Grid sizes do not match.");
+    }
+    if (blocking.depth == 0) {
+        throw std::runtime_error("Blocking depth must be positive.");
+    }
+    blocking.bytes_moved = 0;
+    blocking.naive_bytes = 0;
+    out.rule = rule;
+    out.unstamp();
+    if (n == 0 || height == 0) {
+        out.bands = bands;
+        return;
+    }
+
+    const size_t row_bytes = stride * sizeof(word_t);
+    const size_t words = get_row_words();
+    const kernels::row_fn kernel = kernels::row_kernel(rule);
+    const size_t depth = std::min<uint64_t>(blocking.depth, n);
+    size_t tile_rows = blocking.tile_rows;
+    if (tile_rows == 0) {
+        const size_t fit = TILE_BYTES / row_bytes;
+        tile_rows = fit > 2 * depth + 8 ? fit - 2 * depth : 8;
+    }
+    tile_rows = std::min(tile_rows, height);
+
+    // two generations of one tile with its halo; row i holds source row y0 - depth + i
+    const size_t local_rows = tile_rows + 2 * depth;
+    std::vector<word_t, AlignedAllocator<word_t>> local[2] = {
+        std::vector<word_t, AlignedAllocator<word_t>>(local_rows * stride, 0),
+        std::vector<word_t, AlignedAllocator<word_t>>(local_rows * stride, 0)
+    };
+
+    // passes alternate between out and a back buffer
+    Grid back(width, height);
+    const Grid* src = this;
+    Grid* dst = &out;
+    for (uint64_t done = 0; done < n; ) {
+        const size_t d = std::min<uint64_t>(depth, n - done);
+
+        for (size_t y0 = 0; y0 < height; y0 += tile_rows) {
+            const size_t rows = std::min(tile_rows, height - y0);
+            const size_t span = rows + 2 * d;
+
+            // load the tile and its halo, wrapping around the torus
+            for (size_t i = 0; i < span; ++i) {
+                const size_t y = (y0 + height * (d / height + 1) - d + i) % height;
+                std::copy(src->row(y), src->row(y) + stride, local[0].data() + i * stride);
+            }
+            blocking.bytes_moved += span * row_bytes;
+
+            // every generation the valid rows shrink by one at each end
+            for (size_t g = 1; g <= d; ++g) {
+                const word_t* prev = local[(g - 1) % 2].data();
+                word_t* next = local[g % 2].data();
+                for (size_t i = g; i < span - g; ++i) {
+                    kernel(prev + (i - 1) * stride, prev + i * stride, prev + (i + 1) * stride,
+                           next + i * stride, width, 0, words, rule);
+                }
+            }
+
+            const word_t* result = local[d % 2].data();
+            for (size_t i = 0; i < rows; ++i) {
+                std::copy(result + (d + i) * stride, result + (d + i + 1) * stride, dst->row(y0 + i));
+            }
+            blocking.bytes_moved += rows * row_bytes;
+        }
+
+        // one read and one write of the whole grid per generation
+        blocking.naive_bytes += 2 * d * height * row_bytes;
+        src = dst;
+        dst = dst == &out ? &back : &out;
+        done += d;
+    }
+
+    if (src != &out) {
+        out.bands.swap(back.bands);
+    }
+}
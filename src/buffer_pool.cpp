@@ -0,0 +1,161 @@
+#include "buffer_pool.hpp"
+
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace buffer_pool {
+
+namespace {
+
+// free buffers by (class bytes, alignment)
+struct Pool {
+    std::mutex mutex;
+    std::map<std::pair<size_t, size_t>, std::vector<void*>> free;
+    size_t limit = DEFAULT_LIMIT;
+    BufferPoolStats stats;
+};
+
+// never destroyed, so grids outliving static destruction can still free theirs
+Pool& pool() {
+    static Pool* p = new Pool;
+    return *p;
+}
+
+// bytes rounded up to four classes an octave, at least a cache line, and to
+// whole huge pages from one on
+size_t class_bytes(size_t bytes) {
+    if (bytes >= HUGE_PAGE) {
+        return (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    }
+    size_t octave = 64;
+    while (octave < bytes) octave *= 2;
+    const size_t step = octave >= 512 ? octave / 8 : 64;
+    return (bytes + step - 1) / step * step;
+}
+
+size_t class_align(size_t bytes, size_t align) {
+    return bytes >= HUGE_PAGE && align < HUGE_PAGE ? HUGE_PAGE : align;
+}
+
+void* system_allocate(size_t bytes, size_t align) {
+#ifdef _MSC_VER
+    void* p = _aligned_malloc(bytes, align);
+#else
+    void* p = std::aligned_alloc(align, (bytes + align - 1) / align * align);
+#endif
+    if (!p) throw std::bad_alloc();
+#ifdef __linux__
+    if (bytes >= HUGE_PAGE) {
+        madvise(p, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    return p;
+}
+
+void system_free(void* p) {
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+// frees pooled buffers until at most limit bytes are left; call locked
+void shrink(Pool& p) {
+    for (auto& [key, buffers] : p.free) {
+        while (p.stats.pooled_bytes > p.limit && !buffers.empty()) {
+            system_free(buffers.back());
+            buffers.pop_back();
+            p.stats.pooled_buffers--;
+            p.stats.pooled_bytes -= key.first;
+            p.stats.released++;
+        }
+    }
+}
+
+} // namespace
+
+void* allocate(size_t bytes, size_t align) {
+    const size_t size = class_bytes(bytes ? bytes : 1);
+    const size_t alignment = class_align(size, align);
+    Pool& p = pool();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        auto it = p.free.find({size, alignment});
+        if (it != p.free.end() && !it->second.empty()) {
+            void* buffer = it->second.back();
+            it->second.pop_back();
+            p.stats.hits++;
+            p.stats.pooled_buffers--;
+            p.stats.pooled_bytes -= size;
+            return buffer;
+        }
+        p.stats.misses++;
+    }
+    return system_allocate(size, alignment);
+}
+
+void deallocate(void* buffer, size_t bytes, size_t align) {
+    const size_t size = class_bytes(bytes ? bytes : 1);
+    const size_t alignment = class_align(size, align);
+    Pool& p = pool();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.stats.pooled_bytes + size <= p.limit) {
+            p.free[{size, alignment}].push_back(buffer);
+            p.stats.returned++;
+            p.stats.pooled_buffers++;
+            p.stats.pooled_bytes += size;
+            return;
+        }
+        p.stats.released++;
+    }
+    system_free(buffer);
+}
+
+BufferPoolStats stats() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.stats;
+}
+
+void reset_stats() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    const BufferPoolStats held = p.stats;
+    p.stats = BufferPoolStats();
+    p.stats.pooled_buffers = held.pooled_buffers;
+    p.stats.pooled_bytes = held.pooled_bytes;
+}
+
+void set_limit(size_t bytes) {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.limit = bytes;
+    shrink(p);
+}
+
+size_t get_limit() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.limit;
+}
+
+void trim() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    const size_t limit = p.limit;
+    p.limit = 0;
+    shrink(p);
+    p.limit = limit;
+}
+
+} // namespace buffer_pool
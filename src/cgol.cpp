@@ -1,47 +1,172 @@
 #include "cgol.hpp"
+#include "kernels.hpp"
+#include "hashlife.hpp"
+#include "thread_pool.hpp"
+#include "scheduler.hpp"
+#include "domain.hpp"
 
 #include <algorithm>
+#include <stdexcept>
 
 // returns positive remainder
 size_t mod(int a, int b) {
     return (a % b + b) % b;
 }
 
-bool random_bool() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 1);
+// rounds the words needed for w cells up to a whole cache line
+size_t row_stride(size_t w) {
+    const size_t words = (w + Grid::WORD_BITS - 1) / Grid::WORD_BITS;
+    return (words + Grid::ROW_ALIGN - 1) / Grid::ROW_ALIGN * Grid::ROW_ALIGN;
+}
 
-    return dis(gen);
+// every band starts out as the same empty buffer, the last one too unless it is shorter
+Grid::Grid(size_t w, size_t h): width(w), height(h), stride(row_stride(w)), rule(rules::CONWAY),
+                                bands((h + BAND_ROWS - 1) / BAND_ROWS) {
+    if (bands.empty()) {
+        return;
+    }
+    const std::shared_ptr<Band> empty = std::make_shared<Band>(band_rows(0) * stride, 0);
+    std::fill(bands.begin(), bands.end(), empty);
+    if (band_rows(bands.size() - 1) != band_rows(0)) {
+        bands.back() = std::make_shared<Band>(band_rows(bands.size() - 1) * stride, 0);
+    }
+}
+
+Grid::Grid(size_t w, size_t h, const std::vector<std::vector<bool>>& other): Grid(w, h) {
+    for (size_t y = 0; y < h && y < other.size(); ++y) {
+        for (size_t x = 0; x < w && x < other[y].size(); ++x) {
+            set_cell(x, y, other[y][x]);
+        }
+    }
+}
+
+Grid::Grid(const GridView& view): Grid(view.whole ? 0 : view.width, view.whole ? 0 : view.height) {
+    rule = view.rule;
+    if (view.whole) {
+        width = view.width;
+        height = view.height;
+        stride = view.stride;
+        bands.assign(view.bands, view.bands + (height + BAND_ROWS - 1) / BAND_ROWS);
+        return;
+    }
+    // shift every row down to bit 0, a word at a time
+    const size_t shift = view.x0 % WORD_BITS;
+    const size_t end = shift + width;
+    const size_t words = get_row_words();
+    for (size_t y = 0; y < height; ++y) {
+        const word_t* src = view.row(y);
+        word_t* dst = row(y);
+        for (size_t i = 0; i < words; ++i) {
+            word_t w = src[i] >> shift;
+            if (shift && (i + 1) * WORD_BITS < end) w |= src[i + 1] << (WORD_BITS - shift);
+            dst[i] = w;
+        }
+        if (words > 0) dst[words - 1] &= last_word_mask();
+    }
+}
+
+GridView GridView::window(size_t x, size_t y, size_t w, size_t h) const {
+    if (x + w > width || y + h > height) {
+        throw std::runtime_error("Window out of the view.");
+    }
+    GridView v = *this;
+    v.x0 += x;
+    v.y0 += y;
+    v.width = w;
+    v.height = h;
+    v.whole = whole && v.x0 == 0 && v.y0 == 0 && w == width && h == height;
+    return v;
 }
 
-Grid::Grid(size_t w, size_t h): width(w), height(h), grid(w, std::vector<bool>(h)) {
-    // initialize cells
-    for (size_t x = 0; x < w; ++x) {
-        for (size_t y = 0; y < h; ++y) {
-            grid[x][y] = DEAD;
+GridView GridView::minimal() const {
+    const size_t begin = x0 % Grid::WORD_BITS;
+    const size_t end = begin + width;
+    size_t min_x = end;
+    size_t max_x = 0;
+    size_t min_y = height;
+    size_t max_y = 0;
+    for (size_t y = 0; y < height; ++y) {
+        const word_t* words = row(y);
+        bool live = false;
+        for (size_t i = 0; i * Grid::WORD_BITS < end; ++i) {
+            if (const word_t w = bits(words, i, begin, end)) {
+                min_x = std::min(min_x, i * Grid::WORD_BITS + count_trailing_zeros(w));
+                max_x = std::max(max_x, i * Grid::WORD_BITS + 63 - count_leading_zeros(w));
+                live = true;
+            }
         }
+        if (live) {
+            min_y = std::min(min_y, y);
+            max_y = y;
+        }
+    }
+    if (min_y == height) {
+        return window(0, 0, 0, 0);
     }
+    return window(min_x - begin, min_y, max_x - min_x + 1, max_y - min_y + 1);
 }
 
-Grid::Grid(size_t w, size_t h, const std::vector<std::vector<bool>>& other): width(w), height(h), grid(w, std::vector<bool>(h)) {
-    for (size_t x = 0; x < w; ++x) {
-        for (size_t y = 0; y < h; ++y) {
-            if (x < other[y].size())
-                grid[x][y] = other[y][x];
+size_t GridView::population() const {
+    const size_t begin = x0 % Grid::WORD_BITS;
+    const size_t end = begin + width;
+    size_t n = 0;
+    for (size_t y = 0; y < height; ++y) {
+        const word_t* words = row(y);
+        for (size_t i = 0; i * Grid::WORD_BITS < end; ++i) {
+            n += popcount(bits(words, i, begin, end));
         }
     }
+    return n;
 }
 
 void Grid::random() {
-    for (size_t x = 0; x < width; ++x) {
-        for (size_t y = 0; y < height; ++y) {
-            grid[x][y] = random_bool();
+    std::random_device rd;
+    std::mt19937_64 gen(rd());
+
+    const size_t words = get_row_words();
+    for (size_t y = 0; y < height && words > 0; ++y) {
+        word_t* r = row(y);
+        for (size_t i = 0; i < words; ++i) {
+            r[i] = gen();
         }
+        r[words-1] &= last_word_mask();
+    }
+}
+
+void Grid::unshare(size_t b) {
+    bands[b] = std::make_shared<Band>(*bands[b]);
+}
+
+void Grid::stamp() {
+    static std::atomic<uint64_t> last{0};
+    epoch.value.store(last.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void Grid::detach() {
+    for (size_t b = 0; b < bands.size(); ++b) {
+        band_data(b);
     }
 }
 
-void Grid::place(const Grid& other, size_t x, size_t y) {
+size_t Grid::count_shared_bands() const {
+    size_t n = 0;
+    for (const std::shared_ptr<Band>& band : bands) {
+        n += band.use_count() != 1;
+    }
+    return n;
+}
+
+bool Grid::operator==(const Grid& other) const {
+    if (width != other.width || height != other.height) {
+        return false;
+    }
+    for (size_t b = 0; b < bands.size(); ++b) {
+        if (bands[b] != other.bands[b] && *bands[b] != *other.bands[b]) return false;
+    }
+    return true;
+}
+
+void Grid::place(const GridView& other, size_t x, size_t y) {
     for (size_t j = 0; j < other.get_height(); ++j) {
         for (size_t i = 0; i < other.get_width(); ++i) {
             if (x + i < width && y + j < height) {
@@ -51,7 +176,7 @@ void Grid::place(const Grid& other, size_t x, size_t y) {
     }
 }
 
-void Grid::place_center(const Grid& other) {
+void Grid::place_center(const GridView& other) {
     const int center_x = width/2 - other.get_width()/2;
     const int center_y = height/2 - other.get_height()/2;
     place(other, center_x, center_y);
@@ -66,12 +191,12 @@ int Grid::get_neighbors(size_t x, size_t y, bool wrap) const {
                 if (x == 0 || x == width-1 || y == 0 || y == height-1 || (i == 0 && j == 0)) { 
                     continue; 
                 }
-                neighbors += grid[x+i][y+j];
+                neighbors += get_cell(x+i, y+j);
             }
             else {
                 // wrap around to other side
                 if (i == 0 && j == 0) continue;
-                neighbors += grid[mod(x+i, width)][mod(y+j, height)];
+                neighbors += get_cell(mod(x+i, width), mod(y+j, height));
             }
         }
     }
@@ -79,72 +204,109 @@ int Grid::get_neighbors(size_t x, size_t y, bool wrap) const {
     return neighbors;
 }
 
-Grid Grid::get_next_state() const {
+Grid Grid::get_next_state(Engine engine) const {
+    Grid result(width, height);
+    step_into(result, engine);
+    return result;
+}
+
+void Grid::step_into(Grid& result, Engine engine, ThreadPool* pool) const {
     /*
+    A dead cell becomes live when its live neighbour count is one of the rule's
+    birth counts, and a live cell stays live when it is one of the survival counts.
+    Under B3/S23:
     Any live cell with fewer than two live neighbours dies, as if by underpopulation.
     Any live cell with two or three live neighbours lives on to the next generation.
     Any live cell with more than three live neighbours dies, as if by overpopulation.
     Any dead cell with exactly three live neighbours becomes a live cell, as if by reproduction.
     */
 
-    Grid result(width, height);
+    if (result.width != width || result.height != height) {
+        throw std::runtime_error("Grid sizes do not match.");
+    }
+    result.rule = rule;
+    result.unstamp();
 
-    for (size_t x = 0; x < width; ++x) {
-        for (size_t y = 0; y < height; ++y) {
-            int neighbors = get_neighbors(x, y);
-            if (neighbors < 2 || neighbors > 3) {
-                result.set_cell(x, y, DEAD);
+    if (engine == Engine::Bitsliced) {
+        const kernels::row_fn kernel = kernels::row_kernel(rule);
+        const size_t words = get_row_words();
+        auto compute = [&](size_t y0, size_t y1, word_t* out) {
+            for (size_t y = y0; y < y1; ++y, out += stride) {
+                const word_t* up = row(y == 0 ? height-1 : y-1);
+                const word_t* down = row(y == height-1 ? 0 : y+1);
+                kernel(up, row(y), down, out, width, 0, words, rule);
             }
-            else if (neighbors == 3) {
-                result.set_cell(x, y, LIVE);
+        };
+        // A band the result owns is computed in place and kept, changed or not:
+        // giving it up for this grid's would only mean allocating again once
+        // the band livens up, which breaks allocation-free ping-ponging. A band
+        // the result shares has no storage of its own to keep. It is computed a
+        // row at a time into a scratch row and compared, and only gets storage
+        // at the first row that differs, the rows above being this grid's; while
+        // it comes out the same it is shared with this grid and costs nothing.
+        auto step_bands = [&](size_t begin, size_t end) {
+            thread_local std::vector<word_t> line;
+            if (line.size() < words) {
+                line.resize(words);
             }
-            else {
-                result.set_cell(x, y, grid[x][y]);
+            for (size_t b = begin; b < end; ++b) {
+                const size_t y0 = b * BAND_ROWS;
+                const size_t rows = band_rows(b);
+                std::shared_ptr<Band>& dst = result.bands[b];
+                if (dst.use_count() == 1) {
+                    compute(y0, y0 + rows, dst->data());
+                    continue;
+                }
+                word_t* out = nullptr;
+                for (size_t r = 0; r < rows; ++r) {
+                    if (out) {
+                        compute(y0 + r, y0 + r + 1, out + r * stride);
+                        continue;
+                    }
+                    compute(y0 + r, y0 + r + 1, line.data());
+                    const word_t* before = bands[b]->data();
+                    if (std::equal(line.data(), line.data() + words, before + r * stride)) {
+                        continue;
+                    }
+                    std::shared_ptr<Band> fresh = std::make_shared<Band>(rows * stride);
+                    out = fresh->data();
+                    std::copy(before, before + r * stride, out);
+                    std::copy(line.data(), line.data() + words, out + r * stride);
+                    dst = std::move(fresh);
+                }
+                if (!out) {
+                    dst = bands[b];
+                }
             }
+        };
+        const size_t workers = pool != nullptr ? pool->size() : 1;
+        if (workers > 1 && bands.size() >= workers) {
+            const size_t n = bands.size();
+            pool->run([&](size_t i) { step_bands(n * i / workers, n * (i + 1) / workers); });
         }
-    }
-
-    return result;
-}
-
-Grid Grid::get_minimal() const {
-    // get bounding rectangle by getting min and max coords
-    size_t min_x = width;
-    size_t min_y = height;
-    size_t max_x = 0;
-    size_t max_y = 0;
-    for (size_t x = 0; x < width; ++x) {
-        for (size_t y = 0; y < height; ++y) {
-            if (get_cell(x, y)) {
-                if (x < min_x) { min_x = x; }
-                if (x > max_x) { max_x = x; }
-                if (y < min_y) { min_y = y; }
-                if (y > max_y) { max_y = y; }
-            }
+        else {
+            // with fewer bands than workers the board is small enough for one
+            step_bands(0, bands.size());
         }
+        return;
     }
-    const size_t new_width = max_x - min_x + 1;
-    const size_t new_height = max_y - min_y + 1;
 
-    // copy area in bounding rectangle to new grid
-    Grid minimal(new_width, new_height);
-    for (size_t x = 0; x < new_width; ++x) {
-        for (size_t y = 0; y < new_height; ++y) {
-            minimal.set_cell(x, y, get_cell(min_x+x, min_y+y));
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            result.set_cell(x, y, rule.next(get_cell(x, y), get_neighbors(x, y)));
         }
     }
-    return minimal;
+}
+
+Grid Grid::get_minimal() const {
+    return Grid(GridView(*this).minimal());
 }
 
 void Grid::display() const {
     for (size_t y = 0; y < height; ++y) {
+        const word_t* r = row(y);
         for (size_t x = 0; x < width; ++x) {
-            if (grid[x][y] == LIVE) {
-                std::cout << "X";
-            } 
-            else if (grid[x][y] == DEAD) {
-                std::cout << ".";
-            }
+            std::cout << (((r[x / WORD_BITS] >> (x % WORD_BITS)) & 1) ? "X" : ".");
         }
         std::cout << std::endl;
     }
@@ -152,27 +314,252 @@ void Grid::display() const {
 }
 
 Grid Simulation::reset() {
+    commit();
+    log.seek(grid, tick, 0, recompute());
     tick = 0;
-    return states[tick];
+    tiles.invalidate();
+    return grid;
 }
 
 Grid Simulation::prev() {
+    commit();
+    log.seek(grid, tick, tick - 1, recompute());
     tick--;
-    return states[tick];
+    tiles.invalidate();
+    return grid;
 }
 
 Grid Simulation::next() {
-    if (tick == states.size() - 1) {
-        states.push_back(cur().get_next_state());
+    step();
+    return grid;
+}
+
+void Simulation::commit() {
+    if (edited && history) {
+        // the edited generation starts over from a keyframe
+        log.truncate(tick);
+        log.push_keyframe(grid);
+        fit_history();
+    }
+    edited = false;
+}
+
+History::StepFn Simulation::recompute() {
+    return [this](const Grid& src, Grid& out) { step_grid(src, out); };
+}
+
+void Simulation::fit_history() {
+    if (!history) {
+        return;
+    }
+    bool stepped = log.fit(recompute());
+    const size_t evicted = log.evict(tick, recompute());
+    if (evicted > 0 || log.size() < generations.size()) {
+        // the oldest generations, and the future, no longer fit
+        generations.erase(generations.begin(), generations.begin() + evicted);
+        generations.resize(log.size());
+        tick -= evicted;
+        frontier_at = frontier_at < log.size() + evicted ? frontier_at - evicted : SIZE_MAX;
+        stepped = true;
+    }
+    if (stepped) {
+        // thinning and rebuilding a keyframe stepped other grids
+        tiles.invalidate();
+    }
+}
+
+void Simulation::drop_future() {
+    if (history) {
+        log.truncate(tick + 1);
+        generations.resize(tick + 1);
+    }
+    frontier_at = SIZE_MAX;
+}
+
+Grid& Simulation::back_buffer() {
+    if (spare.get_width() != grid.get_width() || spare.get_height() != grid.get_height()) {
+        spare = Grid(grid.get_width(), grid.get_height());
+    }
+    return spare;
+}
+
+void Simulation::step() {
+    commit();
+    if (history && tick + 1 < log.size()) {
+        if (generations[tick+1] == generations[tick] + 1) {
+            // already computed, by an earlier step() or precompute()
+            log.seek(grid, tick, tick + 1, recompute());
+            tick++;
+            tiles.invalidate();
+            return;
+        }
+        // the next entry jumped ahead with advance()
+        drop_future();
+    }
+
+    const uint64_t allocations = grid_allocations;
+    Grid& back = back_buffer();
+    step_grid(grid, back);
+    if (history) {
+        log.push(grid, back);
+        generations.push_back(generations[tick] + 1);
+        tick++;
     }
     else {
-        states[tick+1] = cur().get_next_state();
+        generations[tick]++;
+    }
+    std::swap(grid, back);
+    if (history) {
+        fit_history();
     }
-    tick++;
 
-    return states[tick];
+    step_allocations += grid_allocations - allocations;
+    steps++;
+}
+
+size_t Simulation::get_precomputed() const {
+    size_t ahead = 0;
+    while (tick + ahead + 1 < generations.size() && generations[tick+ahead+1] == generations[tick+ahead] + 1) {
+        ahead++;
+    }
+    return ahead;
+}
+
+bool Simulation::precompute() {
+    commit();
+    if (!history || tick + get_precomputed() + 1 != log.size()) {
+        return false;
+    }
+    const uint64_t allocations = grid_allocations;
+    const size_t newest = log.size() - 1;
+    if (frontier_at != newest) {
+        frontier = grid;
+        log.seek(frontier, tick, newest, recompute());
+    }
+    Grid next(get_width(), get_height());
+    step_grid(frontier, next);
+    log.push(frontier, next);
+    generations.push_back(generations.back() + 1);
+    frontier = std::move(next);
+    frontier_at = newest + 1;
+    // the tile map now describes the frontier, not the current generation
+    tiles.invalidate();
+    fit_history();
+    step_allocations += grid_allocations - allocations;
+    steps++;
+    return true;
+}
+
+void Simulation::set_history(bool keep) {
+    commit();
+    tiles.invalidate();
+    if (keep == history) {
+        return;
+    }
+    history = keep;
+    // keep the current generation only
+    generations = {generations[tick]};
+    tick = 0;
+    log.clear();
+    frontier_at = SIZE_MAX;
+    if (history) {
+        log.push_keyframe(grid);
+    }
+    // ping-ponging between buffers that share nothing with other grids
+    // allocates nothing; bands that stay quiet are then only shared between the two
+    grid.detach();
+    back_buffer().detach();
+}
+
+size_t Simulation::get_threads() const {
+    return scheduler ? scheduler->size() : pool ? pool->size() : 1;
+}
+
+void Simulation::set_threads(size_t n, bool pin, Schedule s) {
+    schedule = s;
+    tiles.invalidate();
+    if (schedule == Schedule::WorkStealing) {
+        pool = nullptr;
+        scheduler = std::make_shared<WorkStealingScheduler>(n, pin);
+    }
+    else {
+        scheduler = nullptr;
+        pool = n == 1 ? nullptr : std::make_shared<ThreadPool>(n, pin);
+    }
+}
+
+void Simulation::step_grid(const Grid& src, Grid& out) {
+    if (scheduler && engine == Engine::Bitsliced) {
+        src.step_tiles(out, *scheduler, tiles);
+    }
+    else {
+        src.step_into(out, engine, pool.get());
+    }
 }
 
 Grid Simulation::cur() {
-    return states[tick];
-}
\ No newline at end of file
+    return grid;
+}
+
+Grid Simulation::advance(uint64_t n) {
+    if (n == 0) {
+        return grid;
+    }
+    commit();
+    const uint64_t allocations = grid_allocations;
+
+    Grid result(0, 0);
+    // HashLife needs an empty background, B0 rules fall back to stepping
+    if (advance_mode == AdvanceMode::HashLife && !get_rule().births_from_nothing()) {
+        if (!hashlife || hashlife->get_rule() != get_rule()) {
+            hashlife = std::make_shared<HashLife>(get_rule());
+        }
+        result = hashlife->advance_torus(grid, n);
+        tiles.invalidate();
+    }
+    else if (advance_mode == AdvanceMode::TemporalBlocking) {
+        result = Grid(get_width(), get_height());
+        grid.advance_blocked(result, n, blocking);
+        tiles.invalidate();
+    }
+    else if (advance_mode == AdvanceMode::Wavefront) {
+        result = Grid(get_width(), get_height());
+        grid.advance_wavefront(result, n, pool.get(), wavefront);
+        tiles.invalidate();
+    }
+    else if (advance_mode == AdvanceMode::Processes) {
+        result = advance_processes(grid, n, std::min(processes, get_height()));
+        tiles.invalidate();
+    }
+    else {
+        // ping-pong between the result and a back buffer
+        result = history ? grid : std::move(grid);
+        Grid back = history ? Grid(result.get_width(), result.get_height()) : std::move(back_buffer());
+        for (uint64_t i = 0; i < n; ++i) {
+            step_grid(result, back);
+            std::swap(result, back);
+        }
+        if (!history) {
+            spare = std::move(back);
+        }
+    }
+
+    if (history) {
+        drop_future();
+        log.push(grid, result, n == 1);
+        generations.push_back(generations[tick] + n);
+        tick++;
+    }
+    else {
+        generations[tick] += n;
+    }
+    grid = std::move(result);
+    if (history) {
+        fit_history();
+    }
+
+    step_allocations += grid_allocations - allocations;
+    steps += n;
+
+    return grid;
+}
@@ -0,0 +1,394 @@
+#include "domain.hpp"
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define CGOL_HAVE_SHM 1
+#endif
+
+using word_t = Grid::word_t;
+
+namespace {
+
+// the slab with one halo row above (row 0) and one below (row rows+1), with
+// bands of its own, so stepping it never allocates
+Grid with_halos(const Grid& board, size_t y0, size_t rows) {
+    Grid cur(board.get_width(), rows + 2);
+    cur.set_rule(board.get_rule());
+    cur.detach();
+    const size_t words = board.get_row_words();
+    for (size_t y = 0; y < rows; ++y) {
+        std::copy(board.row(y0 + y), board.row(y0 + y) + words, cur.row(y + 1));
+    }
+    return cur;
+}
+
+// one generation of the rows between the halos of cur into next
+void step_rows(const Grid& cur, Grid& next, kernels::row_fn kernel) {
+    const size_t rows = cur.get_height() - 2;
+    const size_t words = cur.get_row_words();
+    for (size_t y = 1; y <= rows; ++y) {
+        kernel(cur.row(y - 1), cur.row(y), cur.row(y + 1), next.row(y), cur.get_width(), 0, words, cur.get_rule());
+    }
+}
+
+} // namespace
+
+Grid step_slab(const Grid& slab, uint64_t n, HaloTransport& transport) {
+    const size_t rows = slab.get_height();
+    const kernels::row_fn kernel = kernels::row_kernel(slab.get_rule());
+
+    Grid cur = with_halos(slab, 0, rows);
+    Grid next(slab.get_width(), rows + 2);
+    next.set_rule(slab.get_rule());
+    for (uint64_t gen = 0; gen < n; ++gen) {
+        transport.send_edges(gen, cur.row(1), cur.row(rows));
+        transport.receive_halos(gen, cur.row(0), cur.row(rows + 1));
+        step_rows(cur, next, kernel);
+        std::swap(cur, next);
+    }
+
+    Grid result(slab.get_width(), rows);
+    result.set_rule(slab.get_rule());
+    for (size_t y = 0; y < rows; ++y) {
+        std::copy(cur.row(y + 1), cur.row(y + 1) + slab.get_row_words(), result.row(y));
+    }
+    return result;
+}
+
+#ifdef CGOL_HAVE_SHM
+
+namespace {
+
+constexpr uint64_t MAGIC = 0x63676f6c2d736c62ull; // "cgol-slb"
+
+// a generation counter on its own cache line
+struct alignas(64) Counter {
+    std::atomic<uint64_t> published;
+};
+
+size_t align_up(size_t n) {
+    return (n + 63) / 64 * 64;
+}
+
+std::runtime_error os_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+// start of the segment, followed by one Counter per rank, the mailboxes
+// (rank, parity, edge) and the board
+struct ShmTransport::Header {
+    uint64_t magic;
+    uint64_t ranks;
+    uint64_t width;
+    uint64_t height;
+    uint64_t stride;
+    uint16_t birth;
+    uint16_t survival;
+    std::atomic<uint32_t> aborted;
+
+    Counter* counters() { return reinterpret_cast<Counter*>(reinterpret_cast<char*>(this) + align_up(sizeof(Header))); }
+    word_t* mailboxes() { return reinterpret_cast<word_t*>(counters() + ranks); }
+    word_t* board() { return mailboxes() + ranks * 4 * stride; }
+
+    static size_t size(uint64_t ranks, uint64_t height, uint64_t stride) {
+        return align_up(sizeof(Header)) + ranks * sizeof(Counter) + (ranks * 4 + height) * stride * sizeof(word_t);
+    }
+};
+
+void ShmTransport::create(const std::string& name, const Grid& g, size_t ranks) {
+    if (ranks == 0 || ranks > g.get_height()) {
+        throw std::runtime_error("Every rank needs at least one row.");
+    }
+    const size_t bytes = Header::size(ranks, g.get_height(), g.get_stride());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw os_error("shm_open " + name);
+    }
+    if (ftruncate(fd, bytes) != 0) {
+        const std::runtime_error e = os_error("ftruncate " + name);
+        close(fd);
+        shm_unlink(name.c_str());
+        throw e;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        const std::runtime_error e = os_error("mmap " + name);
+        shm_unlink(name.c_str());
+        throw e;
+    }
+
+    Header* h = static_cast<Header*>(p);
+    h->magic = MAGIC;
+    h->ranks = ranks;
+    h->width = g.get_width();
+    h->height = g.get_height();
+    h->stride = g.get_stride();
+    h->birth = g.get_rule().birth;
+    h->survival = g.get_rule().survival;
+    new (&h->aborted) std::atomic<uint32_t>(0);
+    for (size_t r = 0; r < ranks; ++r) {
+        new (&h->counters()[r]) Counter{{0}};
+    }
+    for (size_t y = 0; y < g.get_height(); ++y) {
+        std::copy(g.row(y), g.row(y) + g.get_stride(), h->board() + y * g.get_stride());
+    }
+    munmap(p, bytes);
+}
+
+void ShmTransport::unlink(const std::string& name) {
+    shm_unlink(name.c_str());
+}
+
+ShmTransport::ShmTransport(const std::string& name, size_t rank): header(nullptr), bytes(0), own(rank) {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        throw os_error("shm_open " + name);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const std::runtime_error e = os_error("fstat " + name);
+        close(fd);
+        throw e;
+    }
+    bytes = st.st_size;
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        throw os_error("mmap " + name);
+    }
+    header = static_cast<Header*>(p);
+    if (bytes < sizeof(Header) || header->magic != MAGIC || rank >= header->ranks ||
+        bytes < Header::size(header->ranks, header->height, header->stride)) {
+        munmap(p, bytes);
+        throw std::runtime_error("Not a halo segment or no such rank: " + name);
+    }
+}
+
+ShmTransport::~ShmTransport() {
+    munmap(header, bytes);
+}
+
+size_t ShmTransport::ranks() const {
+    return header->ranks;
+}
+
+word_t* ShmTransport::mailbox(size_t rank, uint64_t gen, int edge) const {
+    return header->mailboxes() + ((rank * 2 + gen % 2) * 2 + edge) * header->stride;
+}
+
+word_t* ShmTransport::board_row(size_t y) const {
+    return header->board() + y * header->stride;
+}
+
+bool ShmTransport::wait_for(size_t rank, uint64_t gen) const {
+    const std::atomic<uint64_t>& published = header->counters()[rank].published;
+    while (published.load(std::memory_order_acquire) <= gen) {
+        if (header->aborted.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void ShmTransport::send_edges(uint64_t gen, const word_t* top, const word_t* bottom) {
+    std::copy(top, top + header->stride, mailbox(own, gen, 0));
+    std::copy(bottom, bottom + header->stride, mailbox(own, gen, 1));
+    header->counters()[own].published.store(gen + 1, std::memory_order_release);
+}
+
+void ShmTransport::receive_halos(uint64_t gen, word_t* above, word_t* below) {
+    if (!try_receive_halos(gen, above, below)) {
+        throw std::runtime_error("Halo exchange aborted.");
+    }
+}
+
+bool ShmTransport::try_receive_halos(uint64_t gen, word_t* above, word_t* below) {
+    const size_t n = header->ranks;
+    const size_t up = (own + n - 1) % n;
+    const size_t down = (own + 1) % n;
+    if (!wait_for(up, gen)) {
+        return false;
+    }
+    std::copy(mailbox(up, gen, 1), mailbox(up, gen, 1) + header->stride, above);
+    if (!wait_for(down, gen)) {
+        return false;
+    }
+    std::copy(mailbox(down, gen, 0), mailbox(down, gen, 0) + header->stride, below);
+    return true;
+}
+
+Grid ShmTransport::read_slab() const {
+    const size_t y0 = slab_begin(header->height, own, header->ranks);
+    const size_t y1 = slab_begin(header->height, own + 1, header->ranks);
+    Grid slab(header->width, y1 - y0);
+    slab.set_rule(Rule{header->birth, header->survival});
+    for (size_t y = y0; y < y1; ++y) {
+        std::copy(board_row(y), board_row(y) + header->stride, slab.row(y - y0));
+    }
+    return slab;
+}
+
+void ShmTransport::write_slab(const Grid& slab, size_t first) {
+    const size_t y0 = slab_begin(header->height, own, header->ranks);
+    const size_t y1 = slab_begin(header->height, own + 1, header->ranks);
+    for (size_t y = 0; y < y1 - y0; ++y) {
+        std::copy(slab.row(first + y), slab.row(first + y) + header->stride, board_row(y0 + y));
+    }
+}
+
+Grid ShmTransport::gather() const {
+    Grid g(header->width, header->height);
+    g.set_rule(Rule{header->birth, header->survival});
+    for (size_t y = 0; y < header->height; ++y) {
+        std::copy(board_row(y), board_row(y) + header->stride, g.row(y));
+    }
+    return g;
+}
+
+void ShmTransport::abort() {
+    header->aborted.store(1, std::memory_order_relaxed);
+}
+
+Grid advance_processes(const Grid& g, uint64_t n, size_t processes) {
+    static std::atomic<uint64_t> runs{0};
+    const std::string name = "/cgol-" + std::to_string(getpid()) + "-" + std::to_string(runs++);
+    ShmTransport::create(name, g, processes);
+    // the name is only needed until every rank attached, but dropping it once
+    // all of them are done keeps the launcher simple
+    struct Unlink {
+        const std::string& name;
+        ~Unlink() { ShmTransport::unlink(name); }
+    } unlink_guard{name};
+    ShmTransport control(name, 0);
+
+    // The caller may have other threads, such as pool workers, which can hold
+    // the buffer pool's lock or be halfway through anything else when fork()
+    // copies the process. So everything a rank needs is set up here, and the
+    // forked rank only steps its own two buffers, trades halos through the
+    // segment and exits, without allocating or throwing.
+    struct Rank {
+        std::unique_ptr<ShmTransport> transport;
+        Grid cur;
+        Grid next;
+    };
+    const kernels::row_fn kernel = kernels::row_kernel(g.get_rule());
+    std::vector<Rank> ranks;
+    ranks.reserve(processes);
+    for (size_t r = 0; r < processes; ++r) {
+        const size_t y0 = slab_begin(g.get_height(), r, processes);
+        const size_t rows = slab_begin(g.get_height(), r + 1, processes) - y0;
+        Grid next(g.get_width(), rows + 2);
+        next.set_rule(g.get_rule());
+        next.detach();
+        ranks.push_back(Rank{std::make_unique<ShmTransport>(name, r), with_halos(g, y0, rows), std::move(next)});
+    }
+
+    std::vector<pid_t> pids;
+    pids.reserve(processes);
+    bool failed = false;
+    for (Rank& rank : ranks) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            failed = true;
+            break;
+        }
+        if (pid == 0) {
+            ShmTransport& transport = *rank.transport;
+            Grid* cur = &rank.cur;
+            Grid* next = &rank.next;
+            const size_t rows = cur->get_height() - 2;
+            for (uint64_t gen = 0; gen < n; ++gen) {
+                transport.send_edges(gen, cur->row(1), cur->row(rows));
+                if (!transport.try_receive_halos(gen, cur->row(0), cur->row(rows + 1))) {
+                    _exit(1);
+                }
+                step_rows(*cur, *next, kernel);
+                std::swap(cur, next);
+            }
+            transport.write_slab(*cur, 1);
+            _exit(0);
+        }
+        pids.push_back(pid);
+    }
+    if (failed) {
+        control.abort();
+    }
+
+    // Only the ranks started here are reaped, so other children of the process
+    // are left to whoever started them. They are polled rather than waited for
+    // in turn: as soon as one rank fails the others would wait for its halos
+    // forever, so the failure has to be seen whichever rank it is.
+    while (!pids.empty()) {
+        bool reaped = false;
+        for (size_t i = 0; i < pids.size();) {
+            int status = 0;
+            const pid_t pid = waitpid(pids[i], &status, WNOHANG);
+            if (pid == 0) {
+                ++i;
+                continue;
+            }
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                failed = true;
+                control.abort();
+            }
+            pids.erase(pids.begin() + i);
+            reaped = true;
+        }
+        if (!reaped && !pids.empty()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    if (failed) {
+        throw std::runtime_error("A rank of the decomposed run failed.");
+    }
+    return control.gather();
+}
+
+#else
+
+void ShmTransport::create(const std::string&, const Grid&, size_t) {
+    throw std::runtime_error("Shared memory transport is not supported on this platform.");
+}
+
+void ShmTransport::unlink(const std::string&) {}
+
+ShmTransport::ShmTransport(const std::string&, size_t): header(nullptr), bytes(0), own(0) {
+    throw std::runtime_error("Shared memory transport is not supported on this platform.");
+}
+
+ShmTransport::~ShmTransport() {}
+
+size_t ShmTransport::ranks() const { return 0; }
+void ShmTransport::send_edges(uint64_t, const word_t*, const word_t*) {}
+void ShmTransport::receive_halos(uint64_t, word_t*, word_t*) {}
+bool ShmTransport::try_receive_halos(uint64_t, word_t*, word_t*) { return false; }
+Grid ShmTransport::read_slab() const { return Grid(0, 0); }
+void ShmTransport::write_slab(const Grid&, size_t) {}
+Grid ShmTransport::gather() const { return Grid(0, 0); }
+void ShmTransport::abort() {}
+
+Grid advance_processes(const Grid&, uint64_t, size_t) {
+    throw std::runtime_error("Multi-process runs are not supported on this platform.");
+}
+
+#endif
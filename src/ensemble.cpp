@@ -0,0 +1,145 @@
+#include "ensemble.hpp"
+#include "kernels.hpp"
+#include "bits.hpp"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+Ensemble::Ensemble(size_t count, size_t w, size_t h, const Rule& rule):
+    count(count), width(w), height(h), rule(rule),
+    cells((count + LANES - 1) / LANES * w * h, 0), back(cells.size(), 0),
+    frozen((count + LANES - 1) / LANES, 0), generations(count, 0) {
+    // lanes past the last universe never step
+    if (count % LANES) {
+        frozen.back() = ~word_t(0) << (count % LANES);
+    }
+}
+
+void Ensemble::set_cell(size_t u, size_t x, size_t y, bool state) {
+    const word_t bit = word_t(1) << (u % LANES);
+    if (state) word(u / LANES, x, y) |= bit;
+    else word(u / LANES, x, y) &= ~bit;
+}
+
+void Ensemble::check(size_t u) const {
+    if (u >= count) {
+        throw std::runtime_error("No such universe: " + std::to_string(u));
+    }
+}
+
+void Ensemble::set(size_t u, const GridView& g) {
+    check(u);
+    if (g.get_width() != width || g.get_height() != height) {
+        throw std::runtime_error("Grid sizes do not match.");
+    }
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            set_cell(u, x, y, g.get_cell(x, y));
+        }
+    }
+    generations[u] = 0;
+}
+
+Grid Ensemble::get(size_t u) const {
+    check(u);
+    Grid g(width, height);
+    g.set_rule(rule);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            g.set_cell(x, y, get_cell(u, x, y));
+        }
+    }
+    return g;
+}
+
+void Ensemble::random() {
+    std::random_device rd;
+    std::mt19937_64 gen(rd());
+    for (size_t b = 0; b < frozen.size(); ++b) {
+        const word_t used = b + 1 == frozen.size() && count % LANES ? (word_t(1) << (count % LANES)) - 1 : ~word_t(0);
+        for (size_t i = 0; i < width * height; ++i) {
+            cells[b * width * height + i] = gen() & used;
+        }
+    }
+    std::fill(generations.begin(), generations.end(), 0);
+}
+
+void Ensemble::set_frozen(size_t u, bool state) {
+    // the padding lanes past the last universe stay frozen
+    check(u);
+    const word_t bit = word_t(1) << (u % LANES);
+    if (state) frozen[u / LANES] |= bit;
+    else frozen[u / LANES] &= ~bit;
+}
+
+void Ensemble::step() {
+    const kernels::lane_fn kernel = kernels::lane_kernel(rule);
+    const size_t area = width * height;
+    for (size_t b = 0; b < frozen.size(); ++b) {
+        const word_t* src = cells.data() + b * area;
+        word_t* dst = back.data() + b * area;
+        const word_t keep = frozen[b];
+        if (keep == ~word_t(0)) {
+            std::copy(src, src + area, dst);
+            continue;
+        }
+        for (size_t y = 0; y < height; ++y) {
+            const word_t* up = src + (y == 0 ? height - 1 : y - 1) * width;
+            const word_t* down = src + (y + 1 == height ? 0 : y + 1) * width;
+            kernel(up, src + y * width, down, dst + y * width, width, rule);
+        }
+        if (keep) {
+            for (size_t i = 0; i < area; ++i) {
+                dst[i] = (dst[i] & ~keep) | (src[i] & keep);
+            }
+        }
+    }
+    cells.swap(back);
+
+    for (size_t u = 0; u < count; ++u) {
+        generations[u] += !is_frozen(u);
+    }
+}
+
+void Ensemble::advance(uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        step();
+    }
+}
+
+uint64_t Ensemble::population(size_t u) const {
+    uint64_t total = 0;
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            total += get_cell(u, x, y);
+        }
+    }
+    return total;
+}
+
+std::vector<uint64_t> Ensemble::populations() const {
+    std::vector<uint64_t> result(count, 0);
+    const size_t area = width * height;
+    for (size_t b = 0; b < frozen.size(); ++b) {
+        // a binary counter per lane, bit k of every lane's count in planes[k]
+        std::vector<word_t> planes;
+        for (size_t i = 0; i < area; ++i) {
+            word_t carry = cells[b * area + i];
+            for (size_t k = 0; carry; ++k) {
+                if (k == planes.size()) planes.push_back(0);
+                const word_t next = planes[k] & carry;
+                planes[k] ^= carry;
+                carry = next;
+            }
+        }
+        for (size_t k = 0; k < planes.size(); ++k) {
+            for (word_t bits = planes[k]; bits; bits &= bits - 1) {
+                const size_t u = b * LANES + count_trailing_zeros(bits);
+                if (u < count) result[u] += uint64_t(1) << k;
+            }
+        }
+    }
+    return result;
+}
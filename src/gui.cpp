@@ -5,7 +5,10 @@
 #include <QButtonGroup>
 #include <memory>
 
-SimWidget::SimWidget(QWidget *parent, Grid g): QWidget(parent), sim(g) {
+// ms between checks for a new frame, about 60 fps
+constexpr int FRAME_INTERVAL = 16;
+
+SimWidget::SimWidget(QWidget *parent, Grid g): QWidget(parent), runner(g) {
     create();
 }
 
@@ -13,9 +16,10 @@ void SimWidget::create() {
     setMouseTracking(true);
 
     timer = std::make_unique<QTimer>(this);
-    connect(timer.get(), SIGNAL(timeout()), this, SLOT(update_sim()));
+    connect(timer.get(), SIGNAL(timeout()), this, SLOT(refresh()));
 
-    timer->start(sim.get_delay());
+    timer->start(FRAME_INTERVAL);
+    runner.play();
 }
 
 void SimWidget::paintEvent(QPaintEvent* event) {
@@ -24,44 +28,41 @@ void SimWidget::paintEvent(QPaintEvent* event) {
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing);
 
-    const qreal cellSize = std::min((qreal)width() / sim.get_width(), (qreal)height() / sim.get_height());
+    const GridView grid = current();
+    const qreal cellSize = std::min((qreal)width() / grid.get_width(), (qreal)height() / grid.get_height());
     
-    QRectF bg(0, 0,  cellSize*sim.get_width()-1, cellSize*sim.get_height()-1);
+    QRectF bg(0, 0,  cellSize*grid.get_width(), cellSize*grid.get_height());
     painter.fillRect(bg, QBrush("#FFFFFF"));
 
-    for (size_t y = 0; y < sim.get_height(); ++y) {
-        for (size_t x = 0; x < sim.get_width(); ++x) {
-            if (sim.get_cell(x, y)) {
-                painter.fillRect(x * cellSize, y * cellSize, cellSize, cellSize, Qt::black);
-            } else {
-                painter.fillRect(x * cellSize, y * cellSize, cellSize, cellSize, Qt::white);
-            }
-        }
+    // only the live cells need painting over the background
+    for (size_t y = 0; y < grid.get_height(); ++y) {
+        grid.for_each_live(y, [&](size_t x) {
+            painter.fillRect(QRectF(x * cellSize, y * cellSize, cellSize, cellSize), Qt::black);
+        });
     }
     painter.setPen(QPen(Qt::lightGray, 0.5));
-    for (qreal x = 0; x < sim.get_width(); x++)
-        painter.drawLine(QPointF(x*cellSize, 0), QPointF(x*cellSize, sim.get_height()*cellSize));
-    for (qreal y = 0; y < sim.get_height(); y++)
-        painter.drawLine(QPointF(0, y*cellSize), QPointF(sim.get_width()*cellSize, y*cellSize));
+    for (qreal x = 0; x < grid.get_width(); x++)
+        painter.drawLine(QPointF(x*cellSize, 0), QPointF(x*cellSize, grid.get_height()*cellSize));
+    for (qreal y = 0; y < grid.get_height(); y++)
+        painter.drawLine(QPointF(0, y*cellSize), QPointF(grid.get_width()*cellSize, y*cellSize));
 
 }
 
 void SimWidget::mousePressEvent(QMouseEvent* event) {
     if (event->button() == Qt::LeftButton) {
-        if (timer->isActive()) {
+        if (runner.is_playing()) {
             pause();
         }
         QPoint pos = event->pos();
         
-        const qreal cellSize = std::min((qreal)width() / sim.get_width(), (qreal)height() / sim.get_height());
+        const qreal cellSize = std::min((qreal)width() / grid_width(), (qreal)height() / grid_height());
 
         size_t x = pos.x() / cellSize;
         size_t y = pos.y() / cellSize;
 
-        if (x < sim.get_width() && y < sim.get_height()) {
-            sim.set_cell(x, y, tool);
+        if (x < grid_width() && y < grid_height()) {
+            runner.set_cell(x, y, tool);
             drawing = true;
-            update();
         }
     }
 }
@@ -70,14 +71,13 @@ void SimWidget::mouseMoveEvent(QMouseEvent* event) {
     if (drawing) {
         QPoint pos = event->pos();
         
-        const qreal cellSize = std::min((qreal)width() / sim.get_width(), (qreal)height() / sim.get_height());
+        const qreal cellSize = std::min((qreal)width() / grid_width(), (qreal)height() / grid_height());
 
         size_t x = pos.x() / cellSize;
         size_t y = pos.y() / cellSize;
 
-        if (x < sim.get_width() && y < sim.get_height()) {
-            sim.set_cell(x, y, tool);
-            update();
+        if (x < grid_width() && y < grid_height()) {
+            runner.set_cell(x, y, tool);
         }
     }
 }
@@ -97,32 +97,29 @@ void SimWidget::set_eraser() {
 }
 
 void SimWidget::reset() {
-    sim.reset();
-    update();
+    runner.reset();
 }
 
 void SimWidget::prev() {
-    if (sim.get_tick() > 0) {
-        sim.prev();
-    }
-    update();
+    runner.prev();
 }
 
 void SimWidget::next() {
-    sim.next();
-    update();
+    runner.next();
 }
 
 void SimWidget::pause() {
-    timer->stop();
+    runner.pause();
 }
 
 void SimWidget::play() {
-    timer->start(sim.get_delay());
+    runner.play();
 }
 
-void SimWidget::update_sim() {
-    next();
+void SimWidget::refresh() {
+    if (runner.has_new_frame()) {
+        update();
+    }
 }
 
 GridConfig::GridConfig(QWidget *parent) : QWizard(parent) {
@@ -336,7 +333,7 @@ void MainWindow::createNew() {
 
 void MainWindow::createNewRandom() {
 
-    Grid g(simWidget->sim.get_width(), simWidget->sim.get_height());
+    Grid g(simWidget->grid_width(), simWidget->grid_height());
 
     g.random();
 
@@ -353,10 +350,9 @@ void MainWindow::loadPattern() {
                                                         "Text Files (*.txt *.text);;"
                                                         "Life 1.06 Files (*.lif *.life)"));
     if (!fileName.isEmpty()) {            
-        Grid g(simWidget->sim.get_width(), simWidget->sim.get_height());
-        Grid g2(fileHandler->read(fileName.toStdString()));
-        
-        g.place_center(g2);
+        // the board keeps the pattern's rule, so it steps and saves under it
+        Grid g = fileHandler->read_centered(fileName.toStdString(), simWidget->grid_width(),
+                                            simWidget->grid_height());
         
         simWidget->replace(g);
         update();
@@ -373,8 +369,9 @@ void MainWindow::savePattern() {
                                                         "Life 1.06 Files (*.lif *.life)"));
     try {
         if (!fileName.isEmpty()) {
-            const Grid pattern = simWidget->sim.cur().get_minimal();
-            fileHandler->save(pattern, fileName.toStdString());
+            // the edits and steps queued so far, not just what was last painted
+            simWidget->runner.sync();
+            fileHandler->save(GridView(simWidget->current()).minimal(), fileName.toStdString());
         }
     }
     catch (const std::runtime_error& e) {
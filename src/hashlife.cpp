@@ -0,0 +1,378 @@
+#include "hashlife.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t DEFAULT_MAX_NODES = size_t(1) << 22;
+
+// smallest level whose side is at least n
+int level_for(uint64_t n) {
+    int level = 0;
+    while ((uint64_t(1) << level) < n) ++level;
+    return level;
+}
+
+} // namespace
+
+size_t HashLife::KeyHash::operator()(const Key& k) const {
+    size_t h = reinterpret_cast<uintptr_t>(k.nw);
+    h = h * 0x9e3779b97f4a7c15ull + reinterpret_cast<uintptr_t>(k.ne);
+    h = h * 0x9e3779b97f4a7c15ull + reinterpret_cast<uintptr_t>(k.sw);
+    h = h * 0x9e3779b97f4a7c15ull + reinterpret_cast<uintptr_t>(k.se);
+    return h ^ (h >> 29);
+}
+
+HashLife::HashLife(const Rule& rule): rule(rule), generation(0), step_log2(0), max_nodes(DEFAULT_MAX_NODES) {
+    if (rule.births_from_nothing()) {
+        throw std::runtime_error("HashLife does not support B0 rules: " + rule.to_string());
+    }
+    nodes.push_back(Node{nullptr, nullptr, nullptr, nullptr, 0, 0, nullptr, -1});
+    nodes.push_back(Node{nullptr, nullptr, nullptr, nullptr, 1, 0, nullptr, -1});
+    leaves[0] = &nodes[0];
+    leaves[1] = &nodes[1];
+    root = empty(3);
+}
+
+HashLife::HashLife(const GridView& g, int64_t x, int64_t y): HashLife(g.get_rule()) {
+    const int64_t extent = std::max({-x, x + int64_t(g.get_width()), -y, y + int64_t(g.get_height()), int64_t(4)});
+    const int level = level_for(extent) + 1;
+    const int64_t half = int64_t(1) << (level - 1);
+    root = build(g, level, -half, -half, x, y);
+}
+
+const HashLife::Node* HashLife::join(const Node* nw, const Node* ne, const Node* sw, const Node* se) {
+    const Key key{nw, ne, sw, se};
+    auto it = table.find(key);
+    if (it != table.end()) {
+        return it->second;
+    }
+    nodes.push_back(Node{nw, ne, sw, se, nw->population + ne->population + sw->population + se->population,
+                         nw->level + 1, nullptr, -1});
+    const Node* n = &nodes.back();
+    table.emplace(key, n);
+    return n;
+}
+
+const HashLife::Node* HashLife::empty(int level) {
+    if (empties.empty()) {
+        empties.push_back(leaf(DEAD));
+    }
+    while (int(empties.size()) <= level) {
+        const Node* e = empties.back();
+        empties.push_back(join(e, e, e, e));
+    }
+    return empties[level];
+}
+
+// the centered square of half the side
+const HashLife::Node* HashLife::center(const Node* n) {
+    return join(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+// the square straddling the border between two horizontal neighbours
+const HashLife::Node* HashLife::horizontal(const Node* w, const Node* e) {
+    return join(w->ne, e->nw, w->se, e->sw);
+}
+
+// the square straddling the border between two vertical neighbours
+const HashLife::Node* HashLife::vertical(const Node* n, const Node* s) {
+    return join(n->sw, n->se, s->nw, s->ne);
+}
+
+// the same square surrounded by an empty border, twice the side
+const HashLife::Node* HashLife::expand(const Node* n) {
+    const Node* e = empty(n->level - 1);
+    return join(join(e, e, e, n->nw), join(e, e, n->ne, e),
+                join(e, n->sw, e, e), join(n->se, e, e, e));
+}
+
+// whether all live cells lie in the central quarter
+bool HashLife::is_padded(const Node* n) const {
+    return n->nw->population == n->nw->se->population && n->ne->population == n->ne->sw->population &&
+           n->sw->population == n->sw->ne->population && n->se->population == n->se->nw->population;
+}
+
+// one generation of the central 2x2 of a 4x4 node
+const HashLife::Node* HashLife::base_result(const Node* n) {
+    bool cells[4][4];
+    const Node* quads[2][2] = {{n->nw, n->ne}, {n->sw, n->se}};
+    for (int qy = 0; qy < 2; ++qy) {
+        for (int qx = 0; qx < 2; ++qx) {
+            const Node* q = quads[qy][qx];
+            cells[qy*2][qx*2] = q->nw->population;
+            cells[qy*2][qx*2+1] = q->ne->population;
+            cells[qy*2+1][qx*2] = q->sw->population;
+            cells[qy*2+1][qx*2+1] = q->se->population;
+        }
+    }
+
+    const Node* out[4];
+    for (int y = 1; y <= 2; ++y) {
+        for (int x = 1; x <= 2; ++x) {
+            int neighbors = 0;
+            for (int j = -1; j <= 1; ++j) {
+                for (int i = -1; i <= 1; ++i) {
+                    if (i != 0 || j != 0) neighbors += cells[y+j][x+i];
+                }
+            }
+            out[(y-1)*2 + (x-1)] = leaf(rule.next(cells[y][x], neighbors));
+        }
+    }
+    return join(out[0], out[1], out[2], out[3]);
+}
+
+// The center of n (level k) after 2^j generations, for j <= k-2. Nine overlapping
+// subsquares of level k-1 are reduced to level k-2, advanced when j == k-2 and
+// simply cropped otherwise; four recombined squares then supply the rest.
+const HashLife::Node* HashLife::result(const Node* n, int j) {
+    if (n->population == 0) {
+        return empty(n->level - 1);
+    }
+    if (n->result_step == j) {
+        return n->result;
+    }
+
+    const Node* r;
+    if (n->level == 2) {
+        r = base_result(n);
+    }
+    else {
+        const Node* sub[9] = {
+            n->nw, horizontal(n->nw, n->ne), n->ne,
+            vertical(n->nw, n->sw), center(n), vertical(n->ne, n->se),
+            n->sw, horizontal(n->sw, n->se), n->se
+        };
+        const bool full = j == n->level - 2;
+        const Node* half[9];
+        for (int i = 0; i < 9; ++i) {
+            half[i] = full ? result(sub[i], j - 1) : center(sub[i]);
+        }
+        const int rest = full ? j - 1 : j;
+        r = join(result(join(half[0], half[1], half[3], half[4]), rest),
+                 result(join(half[1], half[2], half[4], half[5]), rest),
+                 result(join(half[3], half[4], half[6], half[7]), rest),
+                 result(join(half[4], half[5], half[7], half[8]), rest));
+    }
+
+    n->result = r;
+    n->result_step = j;
+    return r;
+}
+
+bool HashLife::get_cell(int64_t x, int64_t y) const {
+    const Node* n = root;
+    int64_t half = int64_t(1) << (n->level - 1);
+    if (x < -half || x >= half || y < -half || y >= half) {
+        return DEAD;
+    }
+    int64_t ox = -half;
+    int64_t oy = -half;
+    while (n->level > 0 && n->population > 0) {
+        half = int64_t(1) << (n->level - 1);
+        const bool east = x >= ox + half;
+        const bool south = y >= oy + half;
+        n = south ? (east ? n->se : n->sw) : (east ? n->ne : n->nw);
+        if (east) ox += half;
+        if (south) oy += half;
+    }
+    return n->population > 0;
+}
+
+void HashLife::set_cell(int64_t x, int64_t y, bool state) {
+    while (true) {
+        const int64_t half = int64_t(1) << (root->level - 1);
+        if (x >= -half && x < half && y >= -half && y < half) {
+            root = set(root, -half, -half, x, y, state);
+            return;
+        }
+        root = expand(root);
+    }
+}
+
+const HashLife::Node* HashLife::set(const Node* n, int64_t ox, int64_t oy, int64_t x, int64_t y, bool state) {
+    if (n->level == 0) {
+        return leaf(state);
+    }
+    const int64_t half = int64_t(1) << (n->level - 1);
+    if (y < oy + half) {
+        if (x < ox + half) return join(set(n->nw, ox, oy, x, y, state), n->ne, n->sw, n->se);
+        return join(n->nw, set(n->ne, ox + half, oy, x, y, state), n->sw, n->se);
+    }
+    if (x < ox + half) return join(n->nw, n->ne, set(n->sw, ox, oy + half, x, y, state), n->se);
+    return join(n->nw, n->ne, n->sw, set(n->se, ox + half, oy + half, x, y, state));
+}
+
+// the node of the given level with its top-left cell at (ox, oy), holding g placed at (x, y)
+const HashLife::Node* HashLife::build(const GridView& g, int level, int64_t ox, int64_t oy, int64_t x, int64_t y) {
+    const int64_t side = int64_t(1) << level;
+    if (ox + side <= x || oy + side <= y || ox >= x + int64_t(g.get_width()) || oy >= y + int64_t(g.get_height())) {
+        return empty(level);
+    }
+    if (level == 0) {
+        return leaf(g.get_cell(ox - x, oy - y));
+    }
+    const int64_t half = side / 2;
+    return join(build(g, level - 1, ox, oy, x, y), build(g, level - 1, ox + half, oy, x, y),
+                build(g, level - 1, ox, oy + half, x, y), build(g, level - 1, ox + half, oy + half, x, y));
+}
+
+void HashLife::set_step(int k) {
+    if (k < 0 || k > MAX_STEP) {
+        throw std::runtime_error("Step out of range.");
+    }
+    step_log2 = k;
+}
+
+void HashLife::step(int k) {
+    if (k < 0 || k > MAX_STEP) {
+        throw std::runtime_error("Step out of range.");
+    }
+    if (nodes.size() > max_nodes) {
+        collect_garbage();
+    }
+
+    // pad until the pattern cannot outrun the result square
+    while (root->level < k + 2 || !is_padded(root)) {
+        root = expand(root);
+    }
+    root = expand(root);
+    root = result(root, k);
+    generation += uint64_t(1) << k;
+
+    while (root->level > 3 && is_padded(root)) {
+        root = center(root);
+    }
+}
+
+void HashLife::advance(uint64_t n) {
+    for (int k = 0; n != 0; ++k, n >>= 1) {
+        if (n & 1) {
+            step(k);
+        }
+    }
+}
+
+void HashLife::fill(const Node* n, int64_t ox, int64_t oy, Grid& g, int64_t x, int64_t y) const {
+    const int64_t side = int64_t(1) << n->level;
+    if (n->population == 0 || ox + side <= x || oy + side <= y ||
+        ox >= x + int64_t(g.get_width()) || oy >= y + int64_t(g.get_height())) {
+        return;
+    }
+    if (n->level == 0) {
+        g.set_cell(ox - x, oy - y, LIVE);
+        return;
+    }
+    const int64_t half = side / 2;
+    fill(n->nw, ox, oy, g, x, y);
+    fill(n->ne, ox + half, oy, g, x, y);
+    fill(n->sw, ox, oy + half, g, x, y);
+    fill(n->se, ox + half, oy + half, g, x, y);
+}
+
+Grid HashLife::to_grid(int64_t x, int64_t y, size_t w, size_t h) const {
+    Grid g(w, h);
+    g.set_rule(rule);
+    const int64_t half = int64_t(1) << (root->level - 1);
+    fill(root, -half, -half, g, x, y);
+    return g;
+}
+
+Grid HashLife::advance_torus(const Grid& g, uint64_t n) {
+    if (g.get_rule() != rule) {
+        throw std::runtime_error("Grid rule " + g.get_rule().to_string() + " does not match " + rule.to_string() + ".");
+    }
+    const uint64_t w = g.get_width();
+    const uint64_t h = g.get_height();
+    // one full period must fit in the result square
+    const int min_level = level_for(std::max(w, h)) + 1;
+
+    Grid cur = g;
+    for (int j = 0; n != 0; ++j, n >>= 1) {
+        if (!(n & 1)) {
+            continue;
+        }
+        if (j > MAX_STEP || min_level > 62) {
+            throw std::runtime_error("Step out of range.");
+        }
+        if (nodes.size() > max_nodes) {
+            collect_garbage();
+        }
+        const int level = std::max(j + 2, min_level);
+
+        // The node of a level whose top-left cell has the given phase in the
+        // tiling. Squares with equal phases are equal, so each is built once.
+        struct Phase {
+            int level;
+            uint64_t x;
+            uint64_t y;
+            bool operator==(const Phase& o) const { return level == o.level && x == o.x && y == o.y; }
+        };
+        struct PhaseHash {
+            size_t operator()(const Phase& p) const { return (p.x * 0x9e3779b97f4a7c15ull + p.y) * 64 + p.level; }
+        };
+        std::unordered_map<Phase, const Node*, PhaseHash> built;
+        auto tile = [&](auto& self, int lvl, uint64_t px, uint64_t py) -> const Node* {
+            if (lvl == 0) {
+                return leaf(cur.get_cell(px, py));
+            }
+            auto it = built.find(Phase{lvl, px, py});
+            if (it != built.end()) {
+                return it->second;
+            }
+            const uint64_t half = uint64_t(1) << (lvl - 1);
+            const uint64_t qx = (px + half % w) % w;
+            const uint64_t qy = (py + half % h) % h;
+            const Node* node = join(self(self, lvl - 1, px, py), self(self, lvl - 1, qx, py),
+                                    self(self, lvl - 1, px, qy), self(self, lvl - 1, qx, qy));
+            built.emplace(Phase{lvl, px, py}, node);
+            return node;
+        };
+
+        const Node* next = result(tile(tile, level, 0, 0), j);
+
+        // the result covers [quarter, quarter + 2^(level-1)) on both axes and
+        // holds a full period; fold it back onto the torus
+        const int64_t quarter = int64_t(1) << (level - 2);
+        Grid window(w, h);
+        fill(next, quarter, quarter, window, quarter, quarter);
+        const uint64_t sx = uint64_t(quarter) % w;
+        const uint64_t sy = uint64_t(quarter) % h;
+        Grid folded(w, h);
+        folded.set_rule(rule);
+        for (uint64_t y = 0; y < h; ++y) {
+            for (uint64_t x = 0; x < w; ++x) {
+                if (window.get_cell(x, y)) {
+                    folded.set_cell((x + sx) % w, (y + sy) % h, LIVE);
+                }
+            }
+        }
+        cur = folded;
+    }
+    return cur;
+}
+
+const HashLife::Node* HashLife::copy_into(const Node* n, HashLife& dst, std::unordered_map<const Node*, const Node*>& seen) const {
+    if (n->level == 0) {
+        return dst.leaf(n->population > 0);
+    }
+    auto it = seen.find(n);
+    if (it != seen.end()) {
+        return it->second;
+    }
+    const Node* copy = dst.join(copy_into(n->nw, dst, seen), copy_into(n->ne, dst, seen),
+                                copy_into(n->sw, dst, seen), copy_into(n->se, dst, seen));
+    seen.emplace(n, copy);
+    return copy;
+}
+
+void HashLife::collect_garbage() {
+    HashLife fresh(rule);
+    std::unordered_map<const Node*, const Node*> seen;
+    fresh.root = copy_into(root, fresh, seen);
+    fresh.generation = generation;
+    fresh.step_log2 = step_log2;
+    fresh.max_nodes = max_nodes;
+    *this = std::move(fresh);
+}
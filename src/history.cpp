@@ -0,0 +1,344 @@
+#include "cgol.hpp"
+#include "bits.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+using word_t = Grid::word_t;
+
+void put_count(std::vector<uint8_t>& out, size_t n) {
+    while (n >= 0x80) {
+        out.push_back(uint8_t(n) | 0x80);
+        n >>= 7;
+    }
+    out.push_back(uint8_t(n));
+}
+
+size_t get_count(const uint8_t*& p) {
+    size_t n = 0;
+    for (int shift = 0; ; shift += 7) {
+        const uint8_t byte = *p++;
+        n |= size_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return n;
+    }
+}
+
+// Run-length encodes a ^ b onto out, b null standing for all zero words. Each
+// literal word is a mask of its nonzero bytes followed by those bytes, which
+// keeps the scattered changes of a busy generation to a couple of bytes per word.
+void encode(const word_t* a, const word_t* b, size_t n, std::vector<uint8_t>& out) {
+    auto word = [&](size_t i) { return b ? a[i] ^ b[i] : a[i]; };
+    size_t i = 0;
+    while (i < n) {
+        const size_t zeros = i;
+        while (i < n && word(i) == 0) ++i;
+        const size_t literals = i;
+        while (i < n && word(i) != 0) ++i;
+        put_count(out, literals - zeros);
+        put_count(out, i - literals);
+        for (size_t j = literals; j < i; ++j) {
+            const word_t w = word(j);
+            const size_t mask_at = out.size();
+            out.push_back(0);
+            for (size_t k = 0; k < sizeof(word_t); ++k) {
+                if (const uint8_t byte = uint8_t(w >> (8 * k))) {
+                    out[mask_at] |= uint8_t(1) << k;
+                    out.push_back(byte);
+                }
+            }
+        }
+    }
+}
+
+// XORs n encoded words into g, returning the end of their encoding
+const uint8_t* apply_delta(const uint8_t* p, word_t* g, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        i += get_count(p);
+        const size_t literals = get_count(p);
+        for (size_t j = 0; j < literals; ++j, ++i) {
+            word_t w = 0;
+            for (uint8_t mask = *p++; mask; mask &= mask - 1) {
+                w |= word_t(*p++) << (8 * count_trailing_zeros(mask));
+            }
+            g[i] ^= w;
+        }
+    }
+    return p;
+}
+
+size_t band_words(const Grid& g, size_t b) {
+    return std::min(Grid::BAND_ROWS, g.get_height() - b * Grid::BAND_ROWS) * g.get_stride();
+}
+
+// Encodes band by band. A band g shares with prev is all zeros without looking
+// at it, which makes the delta of a mostly quiet generation cost next to nothing.
+std::vector<uint8_t> encode(const Grid& g, const Grid* prev) {
+    std::vector<uint8_t> out;
+    for (size_t b = 0; b < g.get_bands(); ++b) {
+        const size_t n = band_words(g, b);
+        if (prev && g.shares_band(*prev, b)) {
+            put_count(out, n);
+            put_count(out, 0);
+            continue;
+        }
+        const size_t y = b * Grid::BAND_ROWS;
+        encode(g.row(y), prev ? prev->row(y) : nullptr, n, out);
+    }
+    out.shrink_to_fit();
+    return out;
+}
+
+// XORs encoded data into g; bands the data leaves alone are not touched, so
+// they stay shared with whatever g shares them with
+void apply_delta(const std::vector<uint8_t>& data, Grid& g) {
+    const uint8_t* p = data.data();
+    for (size_t b = 0; b < g.get_bands(); ++b) {
+        const size_t n = band_words(g, b);
+        const uint8_t* q = p;
+        if (get_count(q) == n) {
+            p = q + 1; // a literal count of zero
+            continue;
+        }
+        p = apply_delta(p, g.row(b * Grid::BAND_ROWS), n);
+    }
+}
+
+} // namespace
+
+void History::clear() {
+    entries.clear();
+    bytes = 0;
+    spacing = 0;
+}
+
+void History::truncate(size_t n) {
+    for (size_t i = n; i < entries.size(); ++i) {
+        bytes -= footprint(entries[i]);
+    }
+    if (n < entries.size()) {
+        entries.erase(entries.begin() + n, entries.end());
+    }
+}
+
+void History::append(Entry e) {
+    bytes += footprint(e);
+    entries.push_back(std::move(e));
+}
+
+void History::push_keyframe(const Grid& g) {
+    if (entries.empty()) {
+        width = g.get_width();
+        height = g.get_height();
+    }
+    else if (g.get_width() != width || g.get_height() != height) {
+        throw std::runtime_error("Grid sizes do not match.");
+    }
+    append(Entry{encode(g, nullptr), true, true, false, g.get_rule()});
+}
+
+void History::push(const Grid& prev, const Grid& g, bool derived) {
+    if (entries.empty()) {
+        push_keyframe(g);
+        return;
+    }
+    if (g.get_width() != width || g.get_height() != height ||
+        prev.get_width() != width || prev.get_height() != height) {
+        throw std::runtime_error("Grid sizes do not match.");
+    }
+    const bool keyframe = entries.size() - keyframe_before(entries.size() - 1) >= interval;
+    append(Entry{encode(g, keyframe ? nullptr : &prev), keyframe, !derived, false, g.get_rule()});
+}
+
+void History::store(size_t i, std::vector<uint8_t> data, bool keyframe) {
+    Entry& e = entries[i];
+    bytes -= e.data.size();
+    bytes += data.size();
+    e.data = std::move(data);
+    e.keyframe = keyframe;
+    e.dropped = false;
+}
+
+size_t History::keyframe_before(size_t i) const {
+    while (!entries[i].keyframe) --i;
+    return i;
+}
+
+bool History::forward(Grid& g, Grid& back, size_t i, const StepFn& step, bool restore) {
+    const Entry& e = entries[i];
+    if (!e.dropped) {
+        if (e.keyframe) {
+            g = Grid(width, height);
+        }
+        apply_delta(e.data, g);
+        g.set_rule(e.rule);
+        return false;
+    }
+    if (back.get_width() != width || back.get_height() != height) {
+        back = Grid(width, height);
+    }
+    step(g, back);
+    if (restore) {
+        std::vector<uint8_t> data = encode(back, &g);
+        if (budget == 0 || bytes + data.size() <= budget) {
+            store(i, std::move(data), false);
+        }
+    }
+    std::swap(g, back);
+    return true;
+}
+
+Grid History::get(size_t i, const StepFn& step) {
+    Grid g(width, height);
+    Grid back(0, 0);
+    for (size_t k = keyframe_before(i); k <= i; ++k) {
+        forward(g, back, k, step, true);
+    }
+    g.set_rule(entries[i].rule);
+    return g;
+}
+
+void History::seek(Grid& g, size_t from, size_t to, const StepFn& step) {
+    if (from == to) {
+        return;
+    }
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+
+    // walking back needs a stored delta for every entry it leaves
+    bool walk_back = to < from;
+    for (size_t k = to + 1; walk_back && k <= from; ++k) {
+        walk_back = !entries[k].keyframe && !entries[k].dropped;
+    }
+    const size_t walk = to > from ? to - from : walk_back ? from - to : SIZE_MAX;
+    const size_t key = keyframe_before(to);
+
+    Grid back(0, 0);
+    uint64_t recomputed = 0;
+    if (to - key + 1 <= walk) {
+        for (size_t k = key; k <= to; ++k) {
+            recomputed += forward(g, back, k, step, true);
+        }
+    }
+    else if (from < to) {
+        for (size_t k = from + 1; k <= to; ++k) {
+            recomputed += forward(g, back, k, step, true);
+        }
+    }
+    else {
+        for (size_t k = from; k > to; --k) {
+            apply_delta(entries[k].data, g);
+        }
+    }
+    g.set_rule(entries[to].rule);
+
+    if (to < from) {
+        backward_seeks++;
+        backward_recomputed += recomputed;
+        backward_seconds += std::chrono::duration<double>(clock::now() - start).count();
+    }
+}
+
+void History::thin(size_t every, const StepFn& step) {
+    // every checkpoint first, while the entries it is rebuilt from are all there;
+    // spacings are powers of two, so earlier checkpoints are keyframes already
+    Grid back(0, 0);
+    for (size_t i = 0; i < entries.size(); i += every) {
+        if (entries[i].keyframe) continue;
+        Grid g(width, height);
+        for (size_t k = keyframe_before(i); k <= i; ++k) {
+            forward(g, back, k, step, false);
+        }
+        store(i, encode(g, nullptr), true);
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Entry& e = entries[i];
+        if (i % every != 0 && !e.pinned && !e.dropped) {
+            bytes -= e.data.size();
+            e.data = std::vector<uint8_t>();
+            e.keyframe = false;
+            e.dropped = true;
+        }
+    }
+}
+
+bool History::fit(const StepFn& step) {
+    if (budget == 0 || bytes <= budget) {
+        return false;
+    }
+    // start around sqrt(entries) apart, and never closer than last time
+    size_t every = 2;
+    while (every * every < entries.size()) every *= 2;
+    every = std::max(every, spacing);
+    for (;;) {
+        thin(every, step);
+        spacing = every;
+        if (bytes <= budget / 2 || every >= entries.size()) break;
+        every *= 2;
+    }
+    return true;
+}
+
+size_t History::evict(size_t keep, const StepFn& step) {
+    if (budget == 0 || bytes <= budget || entries.empty()) {
+        return 0;
+    }
+    keep = std::min(keep, entries.size() - 1);
+    // the oldest entries a keyframe at a time, stopping at entry keep at the latest
+    size_t cut = 0;
+    uint64_t removed = 0;
+    while (cut < keep && bytes - removed > budget) {
+        do {
+            removed += footprint(entries[cut++]);
+        } while (cut < keep && !entries[cut].keyframe);
+    }
+    if (cut > 0) {
+        if (!entries[cut].keyframe) {
+            Grid g(width, height);
+            Grid back(0, 0);
+            for (size_t k = keyframe_before(cut); k <= cut; ++k) {
+                forward(g, back, k, step, false);
+            }
+            store(cut, encode(g, nullptr), true);
+        }
+        entries.erase(entries.begin(), entries.begin() + cut);
+        bytes -= removed;
+    }
+    // then the newest, down to the one kept
+    size_t n = entries.size();
+    for (uint64_t left = bytes; n > keep - cut + 1 && left > budget; --n) {
+        left -= footprint(entries[n - 1]);
+    }
+    truncate(n);
+    return cut;
+}
+
+std::vector<size_t> History::checkpoints() const {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].keyframe) result.push_back(i);
+    }
+    return result;
+}
+
+HistoryStats History::stats() const {
+    HistoryStats s;
+    s.entries = entries.size();
+    for (const Entry& e : entries) {
+        s.keyframes += e.keyframe;
+        s.dropped += e.dropped;
+    }
+    s.spacing = spacing;
+    s.bytes = bytes;
+    const size_t row_words = (width + Grid::WORD_BITS - 1) / Grid::WORD_BITS;
+    const size_t stride = (row_words + Grid::ROW_ALIGN - 1) / Grid::ROW_ALIGN * Grid::ROW_ALIGN;
+    s.raw_bytes = uint64_t(entries.size()) * height * stride * sizeof(word_t);
+    s.budget = budget;
+    s.backward_seeks = backward_seeks;
+    s.backward_recomputed = backward_recomputed;
+    s.backward_seconds = backward_seconds;
+    return s;
+}
@@ -0,0 +1,242 @@
+#ifndef CGOL_KERNEL_IMPL_HPP
+#define CGOL_KERNEL_IMPL_HPP
+
+// Shared body of the row kernels. Every instruction-set variant includes this file
+// and instantiates step_row_vec with its own vector type, so everything here lives
+// in an anonymous namespace: each translation unit keeps its own copy compiled
+// for its own target.
+//
+// Inline functions with external linkage are another matter: a copy the
+// compiler emits in a file built with -mavx2 or -mavx512f is a weak symbol the
+// linker may pick for the whole program, older CPUs included. So nothing here
+// calls one. Rules are compared in kernels.cpp, which hands the variants a
+// RuleKernel, and the kernels read only the rule's plain bit masks; the
+// standard library contributes types alone. After changing this file, check
+// with nm on an unoptimised build that the variants' objects define no weak
+// symbols.
+
+#include "kernels.hpp"
+
+#include <utility>
+
+namespace kernels {
+
+namespace {
+
+constexpr size_t WORD_BITS = 64;
+
+// Live-neighbour counts of every lane as four bit planes: count = b0 + 2b1 + 4b2 + 8b3.
+template <class V>
+struct Counts {
+    V b0, b1, b2, b3;
+};
+
+// Bitsliced neighbour count: each argument holds one neighbour for a whole word or
+// vector of cells, and full adders sum the eight of them into bit planes, so every
+// operation updates all lanes at once.
+template <class V>
+inline Counts<V> count(V nw, V n, V ne, V w, V e, V sw, V s, V se) {
+    // row above and row below: three cells each, sums 0..3
+    const V a0 = nw ^ n ^ ne;
+    const V a1 = (nw & n) | (ne & (nw ^ n));
+    const V d0 = sw ^ s ^ se;
+    const V d1 = (sw & s) | (se & (sw ^ s));
+    // same row: two cells, sums 0..2
+    const V m0 = w ^ e;
+    const V m1 = w & e;
+
+    // ones
+    const V b0 = a0 ^ d0 ^ m0;
+    const V c1 = (a0 & d0) | (m0 & (a0 ^ d0));
+    // twos: a1 + d1 + m1 + c1
+    const V t0 = a1 ^ d1 ^ m1;
+    const V t1 = (a1 & d1) | (m1 & (a1 ^ d1));
+    const V b1 = t0 ^ c1;
+    const V t2 = t0 & c1;
+    // fours and eight
+    const V b2 = t1 ^ t2;
+    const V b3 = t1 & t2;
+    return Counts<V>{b0, b1, b2, b3};
+}
+
+// lanes with exactly k live neighbours
+template <class V>
+inline V equals(const Counts<V>& n, int k) {
+    return (k & 1 ? n.b0 : ~n.b0) & (k & 2 ? n.b1 : ~n.b1) & (k & 4 ? n.b2 : ~n.b2) & (k & 8 ? n.b3 : ~n.b3);
+}
+
+// lanes whose count is in the compile-time set Mask
+template <uint16_t Mask, class V, size_t... K>
+inline V any_of(const Counts<V>& n, V none, std::index_sequence<K...>) {
+    V r = none;
+    ((r = ((Mask >> K) & 1) ? (r | equals(n, int(K))) : r), ...);
+    return r;
+}
+
+// A rule fixed at compile time: only the counts it names are ever tested.
+template <uint16_t Birth, uint16_t Survival>
+struct StaticRule {
+    template <class V>
+    static V apply(const Counts<V>& n, V c, const Rule&) {
+        const V none = c ^ c;
+        const V born = any_of<Birth>(n, none, std::make_index_sequence<9>());
+        const V kept = any_of<Survival>(n, none, std::make_index_sequence<9>());
+        return (born & ~c) | (kept & c);
+    }
+};
+
+// B3/S23: alive with 3 neighbours, or with 2 if already alive
+template <>
+struct StaticRule<rules::CONWAY.birth, rules::CONWAY.survival> {
+    template <class V>
+    static V apply(const Counts<V>& n, V c, const Rule&) {
+        return n.b1 & ~n.b2 & ~n.b3 & (n.b0 | c);
+    }
+};
+
+// Any rule, read at run time.
+struct DynamicRule {
+    template <class V>
+    static V apply(const Counts<V>& n, V c, const Rule& rule) {
+        V r = c ^ c;
+        for (int k = 0; k <= 8; ++k) {
+            const bool born = (rule.birth >> k) & 1;
+            const bool kept = (rule.survival >> k) & 1;
+            if (born && kept) r = r | equals(n, k);
+            else if (born) r = r | (equals(n, k) & ~c);
+            else if (kept) r = r | (equals(n, k) & c);
+        }
+        return r;
+    }
+};
+
+// next state of the center cells c from their eight neighbours
+template <class R, class V>
+inline V life(V nw, V n, V ne, V w, V c, V e, V sw, V s, V se, const Rule& rule) {
+    return R::apply(count(nw, n, ne, w, e, sw, s, se), c, rule);
+}
+
+// One plain word, the vector type of the scalar kernel and of leftover words.
+struct Word {
+    static constexpr size_t LANES = 1;
+    word_t v;
+
+    static Word load(const word_t* p) { return {*p}; }
+    void store(word_t* p) const { *p = v; }
+
+    friend Word operator&(Word a, Word b) { return {a.v & b.v}; }
+    friend Word operator|(Word a, Word b) { return {a.v | b.v}; }
+    friend Word operator^(Word a, Word b) { return {a.v ^ b.v}; }
+    friend Word operator~(Word a) { return {~a.v}; }
+    friend Word operator<<(Word a, int k) { return {a.v << k}; }
+    friend Word operator>>(Word a, int k) { return {a.v >> k}; }
+};
+
+// neighbour to the west (x-1) of every cell in word i, wrapping at the row start
+inline word_t west(const word_t* r, size_t i, size_t width) {
+    const word_t carry = i > 0 ? r[i-1] >> (WORD_BITS-1) : (r[(width-1) / WORD_BITS] >> ((width-1) % WORD_BITS)) & 1;
+    return (r[i] << 1) | carry;
+}
+
+// neighbour to the east (x+1) of every cell in word i, wrapping at the row end
+inline word_t east(const word_t* r, size_t i, size_t n, size_t width) {
+    word_t v = r[i] >> 1;
+    if (i + 1 < n) v |= r[i+1] << (WORD_BITS-1);
+    else v |= (r[0] & 1) << ((width-1) % WORD_BITS);
+    return v;
+}
+
+template <class R>
+inline word_t step_word(const word_t* up, const word_t* mid, const word_t* down, size_t i, size_t n, size_t width, const Rule& rule) {
+    return life<R>(west(up, i, width), up[i], east(up, i, n, width),
+                   west(mid, i, width), mid[i], east(mid, i, n, width),
+                   west(down, i, width), down[i], east(down, i, n, width), rule);
+}
+
+// Interior words never wrap, so their neighbours come straight from the adjacent
+// words. V::load reads LANES words from an arbitrarily aligned pointer.
+template <class V, class R>
+inline V step_inner(const word_t* up, const word_t* mid, const word_t* down, size_t i, const Rule& rule) {
+    const V u = V::load(up+i), m = V::load(mid+i), d = V::load(down+i);
+    return life<R>((u << 1) | (V::load(up+i-1) >> (WORD_BITS-1)), u, (u >> 1) | (V::load(up+i+1) << (WORD_BITS-1)),
+                   (m << 1) | (V::load(mid+i-1) >> (WORD_BITS-1)), m, (m >> 1) | (V::load(mid+i+1) << (WORD_BITS-1)),
+                   (d << 1) | (V::load(down+i-1) >> (WORD_BITS-1)), d, (d >> 1) | (V::load(down+i+1) << (WORD_BITS-1)), rule);
+}
+
+// Steps words [begin, end): the wrapping first and last words and any leftover
+// interior words go one at a time, the rest V::LANES words per iteration.
+template <class V, class R>
+void step_row_vec(const word_t* up, const word_t* mid, const word_t* down, word_t* out,
+                  size_t width, size_t begin, size_t end, const Rule& rule) {
+    const size_t n = (width + WORD_BITS - 1) / WORD_BITS;
+    size_t i = begin;
+    if (i == 0 && i < end) {
+        out[0] = step_word<R>(up, mid, down, 0, n, width, rule);
+        i = 1;
+    }
+    const size_t inner_end = end < n - 1 ? end : n - 1;
+    for (; i + V::LANES <= inner_end; i += V::LANES) {
+        step_inner<V, R>(up, mid, down, i, rule).store(out+i);
+    }
+    for (; i < end; ++i) {
+        out[i] = i + 1 == n ? step_word<R>(up, mid, down, i, n, width, rule) : step_inner<Word, R>(up, mid, down, i, rule).v;
+    }
+    if (end == n && width % WORD_BITS) {
+        out[n-1] &= (word_t(1) << (width % WORD_BITS)) - 1;
+    }
+}
+
+// Steps one row of an ensemble, where word x holds cell x of 64 universes, one per
+// bit. Neighbours are whole words, so no shifts are needed; the row wraps around.
+template <class V, class R>
+void step_lanes_vec(const word_t* up, const word_t* mid, const word_t* down, word_t* out,
+                    size_t width, const Rule& rule) {
+    auto scalar = [&](size_t x) {
+        const size_t l = x == 0 ? width - 1 : x - 1;
+        const size_t r = x + 1 == width ? 0 : x + 1;
+        return life<R>(up[l], up[x], up[r], mid[l], mid[x], mid[r], down[l], down[x], down[r], rule);
+    };
+    if (width == 0) {
+        return;
+    }
+    out[0] = scalar(0);
+    size_t x = 1;
+    for (; x + V::LANES < width; x += V::LANES) {
+        life<R>(V::load(up+x-1), V::load(up+x), V::load(up+x+1),
+                V::load(mid+x-1), V::load(mid+x), V::load(mid+x+1),
+                V::load(down+x-1), V::load(down+x), V::load(down+x+1), rule).store(out+x);
+    }
+    for (; x < width; ++x) {
+        out[x] = scalar(x);
+    }
+}
+
+// Calls pick with the rule policy named by `rule`.
+template <class Pick>
+auto select_rule(RuleKernel rule, Pick pick) {
+    switch (rule) {
+    case RuleKernel::Conway: return pick(StaticRule<rules::CONWAY.birth, rules::CONWAY.survival>());
+    case RuleKernel::HighLife: return pick(StaticRule<rules::HIGHLIFE.birth, rules::HIGHLIFE.survival>());
+    case RuleKernel::DayAndNight: return pick(StaticRule<rules::DAY_AND_NIGHT.birth, rules::DAY_AND_NIGHT.survival>());
+    case RuleKernel::Seeds: return pick(StaticRule<rules::SEEDS.birth, rules::SEEDS.survival>());
+    case RuleKernel::Generic: break;
+    }
+    return pick(DynamicRule());
+}
+
+// the row and ensemble kernels of a rule for vector type V
+template <class V>
+row_fn select_kernel(RuleKernel rule) {
+    return select_rule(rule, [](auto r) -> row_fn { return step_row_vec<V, decltype(r)>; });
+}
+
+template <class V>
+lane_fn select_lane_kernel(RuleKernel rule) {
+    return select_rule(rule, [](auto r) -> lane_fn { return step_lanes_vec<V, decltype(r)>; });
+}
+
+} // namespace
+
+} // namespace kernels
+
+#endif /* CGOL_KERNEL_IMPL_HPP */
@@ -0,0 +1,164 @@
+#include "kernels.hpp"
+#include "kernel_impl.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace kernels {
+
+namespace {
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+bool cpu_has(Isa isa) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = info[3] & (1 << 26);
+    const bool osxsave = info[2] & (1 << 27);
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    int ext[4] = {0, 0, 0, 0};
+    if (max_leaf >= 7) __cpuidex(ext, 7, 0);
+    switch (isa) {
+    case Isa::Scalar: return true;
+    case Isa::SSE2: return sse2;
+    case Isa::AVX2: return (xcr0 & 0x6) == 0x6 && (ext[1] & (1 << 5));
+    case Isa::AVX512: return (xcr0 & 0xe6) == 0xe6 && (ext[1] & (1 << 16));
+    }
+    return false;
+#else
+    __builtin_cpu_init();
+    switch (isa) {
+    case Isa::Scalar: return true;
+    case Isa::SSE2: return __builtin_cpu_supports("sse2");
+    case Isa::AVX2: return __builtin_cpu_supports("avx2");
+    case Isa::AVX512: return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+#endif
+}
+#else
+bool cpu_has(Isa isa) {
+    return isa == Isa::Scalar;
+}
+#endif
+
+row_fn kernel_for(Isa isa, RuleKernel rule = RuleKernel::Conway) {
+    switch (isa) {
+    case Isa::Scalar: return scalar_kernel(rule);
+    case Isa::SSE2: return sse2_kernel(rule);
+    case Isa::AVX2: return avx2_kernel(rule);
+    case Isa::AVX512: return avx512_kernel(rule);
+    }
+    return nullptr;
+}
+
+lane_fn lane_kernel_for(Isa isa, RuleKernel rule) {
+    switch (isa) {
+    case Isa::Scalar: return scalar_lane_kernel(rule);
+    case Isa::SSE2: return sse2_lane_kernel(rule);
+    case Isa::AVX2: return avx2_lane_kernel(rule);
+    case Isa::AVX512: return avx512_lane_kernel(rule);
+    }
+    return nullptr;
+}
+
+const Isa ALL_ISAS[] = {Isa::AVX512, Isa::AVX2, Isa::SSE2, Isa::Scalar};
+
+// fastest supported variant, unless CGOL_KERNEL asks for another one
+Isa startup_isa() {
+    Isa best = Isa::Scalar;
+    for (Isa isa : ALL_ISAS) {
+        if (isa_supported(isa)) {
+            best = isa;
+            break;
+        }
+    }
+
+    const char* forced = std::getenv("CGOL_KERNEL");
+    if (forced == nullptr || *forced == '\0') {
+        return best;
+    }
+    for (Isa isa : ALL_ISAS) {
+        if (std::strcmp(forced, isa_name(isa)) == 0) {
+            if (isa_supported(isa)) {
+                return isa;
+            }
+            std::cerr << "Warning: CGOL_KERNEL=" << forced << " is not supported here, using " << isa_name(best) << "." << std::endl;
+            return best;
+        }
+    }
+    std::cerr << "Warning: unknown CGOL_KERNEL=" << forced << ", using " << isa_name(best) << "." << std::endl;
+    return best;
+}
+
+Isa& dispatch() {
+    static Isa isa = startup_isa();
+    return isa;
+}
+
+} // namespace
+
+RuleKernel rule_kernel(const Rule& rule) {
+    if (rule == rules::CONWAY) return RuleKernel::Conway;
+    if (rule == rules::HIGHLIFE) return RuleKernel::HighLife;
+    if (rule == rules::DAY_AND_NIGHT) return RuleKernel::DayAndNight;
+    if (rule == rules::SEEDS) return RuleKernel::Seeds;
+    return RuleKernel::Generic;
+}
+
+row_fn scalar_kernel(RuleKernel rule) {
+    return select_kernel<Word>(rule);
+}
+
+lane_fn scalar_lane_kernel(RuleKernel rule) {
+    return select_lane_kernel<Word>(rule);
+}
+
+void step_row(const word_t* up, const word_t* mid, const word_t* down, word_t* out,
+              size_t width, size_t begin, size_t end, const Rule& rule) {
+    row_kernel(rule)(up, mid, down, out, width, begin, end, rule);
+}
+
+row_fn row_kernel(const Rule& rule) {
+    return kernel_for(dispatch(), rule_kernel(rule));
+}
+
+lane_fn lane_kernel(const Rule& rule) {
+    return lane_kernel_for(dispatch(), rule_kernel(rule));
+}
+
+Isa active_isa() {
+    return dispatch();
+}
+
+const char* isa_name(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar: return "scalar";
+    case Isa::SSE2: return "sse2";
+    case Isa::AVX2: return "avx2";
+    case Isa::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool isa_supported(Isa isa) {
+    return kernel_for(isa) != nullptr && cpu_has(isa);
+}
+
+void set_isa(Isa isa) {
+    if (!isa_supported(isa)) {
+        throw std::runtime_error(std::string("Kernel not supported: ") + isa_name(isa));
+    }
+    dispatch() = isa;
+}
+
+} // namespace kernels
@@ -0,0 +1,51 @@
+// Built with AVX2 enabled; only reached when the CPU reports AVX2.
+#include "kernels.hpp"
+
+#if defined(__AVX2__)
+
+#include "kernel_impl.hpp"
+
+#include <immintrin.h>
+
+namespace kernels {
+
+namespace {
+
+struct Avx2 {
+    static constexpr size_t LANES = 4;
+    __m256i v;
+
+    static Avx2 load(const word_t* p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))}; }
+    void store(word_t* p) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+
+    friend Avx2 operator&(Avx2 a, Avx2 b) { return {_mm256_and_si256(a.v, b.v)}; }
+    friend Avx2 operator|(Avx2 a, Avx2 b) { return {_mm256_or_si256(a.v, b.v)}; }
+    friend Avx2 operator^(Avx2 a, Avx2 b) { return {_mm256_xor_si256(a.v, b.v)}; }
+    friend Avx2 operator~(Avx2 a) { return {_mm256_xor_si256(a.v, _mm256_set1_epi32(-1))}; }
+    friend Avx2 operator<<(Avx2 a, int k) { return {_mm256_slli_epi64(a.v, k)}; }
+    friend Avx2 operator>>(Avx2 a, int k) { return {_mm256_srli_epi64(a.v, k)}; }
+};
+
+} // namespace
+
+row_fn avx2_kernel(RuleKernel rule) {
+    return select_kernel<Avx2>(rule);
+}
+
+lane_fn avx2_lane_kernel(RuleKernel rule) {
+    return select_lane_kernel<Avx2>(rule);
+}
+
+} // namespace kernels
+
+#else
+
+kernels::row_fn kernels::avx2_kernel(RuleKernel) {
+    return nullptr;
+}
+
+kernels::lane_fn kernels::avx2_lane_kernel(RuleKernel) {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,52 @@
+// Built with AVX-512F enabled; only reached when the CPU reports AVX-512F.
+#include "kernels.hpp"
+
+#if defined(__AVX512F__)
+
+#include "kernel_impl.hpp"
+
+#include <immintrin.h>
+
+namespace kernels {
+
+namespace {
+
+struct Avx512 {
+    static constexpr size_t LANES = 8;
+    __m512i v;
+
+    static Avx512 load(const word_t* p) { return {_mm512_loadu_si512(p)}; }
+    void store(word_t* p) const { _mm512_storeu_si512(p, v); }
+
+    friend Avx512 operator&(Avx512 a, Avx512 b) { return {_mm512_and_si512(a.v, b.v)}; }
+    friend Avx512 operator|(Avx512 a, Avx512 b) { return {_mm512_or_si512(a.v, b.v)}; }
+    friend Avx512 operator^(Avx512 a, Avx512 b) { return {_mm512_xor_si512(a.v, b.v)}; }
+    friend Avx512 operator~(Avx512 a) { return {_mm512_ternarylogic_epi64(a.v, a.v, a.v, 0x55)}; }
+    // zero-masked shifts: the unmasked forms trip GCC's -Wmaybe-uninitialized
+    friend Avx512 operator<<(Avx512 a, int k) { return {_mm512_maskz_slli_epi64(0xff, a.v, k)}; }
+    friend Avx512 operator>>(Avx512 a, int k) { return {_mm512_maskz_srli_epi64(0xff, a.v, k)}; }
+};
+
+} // namespace
+
+row_fn avx512_kernel(RuleKernel rule) {
+    return select_kernel<Avx512>(rule);
+}
+
+lane_fn avx512_lane_kernel(RuleKernel rule) {
+    return select_lane_kernel<Avx512>(rule);
+}
+
+} // namespace kernels
+
+#else
+
+kernels::row_fn kernels::avx512_kernel(RuleKernel) {
+    return nullptr;
+}
+
+kernels::lane_fn kernels::avx512_lane_kernel(RuleKernel) {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,51 @@
+// Built with SSE2 enabled; only reached when the CPU reports SSE2.
+#include "kernels.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+#include "kernel_impl.hpp"
+
+#include <emmintrin.h>
+
+namespace kernels {
+
+namespace {
+
+struct Sse2 {
+    static constexpr size_t LANES = 2;
+    __m128i v;
+
+    static Sse2 load(const word_t* p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))}; }
+    void store(word_t* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+
+    friend Sse2 operator&(Sse2 a, Sse2 b) { return {_mm_and_si128(a.v, b.v)}; }
+    friend Sse2 operator|(Sse2 a, Sse2 b) { return {_mm_or_si128(a.v, b.v)}; }
+    friend Sse2 operator^(Sse2 a, Sse2 b) { return {_mm_xor_si128(a.v, b.v)}; }
+    friend Sse2 operator~(Sse2 a) { return {_mm_xor_si128(a.v, _mm_set1_epi32(-1))}; }
+    friend Sse2 operator<<(Sse2 a, int k) { return {_mm_slli_epi64(a.v, k)}; }
+    friend Sse2 operator>>(Sse2 a, int k) { return {_mm_srli_epi64(a.v, k)}; }
+};
+
+} // namespace
+
+row_fn sse2_kernel(RuleKernel rule) {
+    return select_kernel<Sse2>(rule);
+}
+
+lane_fn sse2_lane_kernel(RuleKernel rule) {
+    return select_lane_kernel<Sse2>(rule);
+}
+
+} // namespace kernels
+
+#else
+
+kernels::row_fn kernels::sse2_kernel(RuleKernel) {
+    return nullptr;
+}
+
+kernels::lane_fn kernels::sse2_lane_kernel(RuleKernel) {
+    return nullptr;
+}
+
+#endif
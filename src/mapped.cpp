@@ -0,0 +1,354 @@
+#include "mapped.hpp"
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CGOL_HAVE_MMAP 1
+#endif
+
+using word_t = Grid::word_t;
+
+#ifdef CGOL_HAVE_MMAP
+
+namespace {
+
+constexpr uint64_t MAGIC = 0x63676f6c2d6d6170ull; // "cgol-map"
+// the header page, and the alignment of both boards
+constexpr size_t PAGE = 4096;
+
+size_t align_page(size_t n) {
+    return (n + PAGE - 1) / PAGE * PAGE;
+}
+
+std::runtime_error os_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void write_all(int fd, const void* data, size_t n, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (n > 0) {
+        const ssize_t written = pwrite(fd, p, n, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw os_error("pwrite");
+        }
+        p += written;
+        n -= written;
+        offset += written;
+    }
+}
+
+// bytes the process read from and wrote to storage so far
+void disk_bytes(uint64_t& read, uint64_t& written) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    read = uint64_t(usage.ru_inblock) * 512;
+    written = uint64_t(usage.ru_oublock) * 512;
+}
+
+} // namespace
+
+struct MappedGrid::Header {
+    uint64_t magic;
+    uint64_t width;
+    uint64_t height;
+    uint64_t stride;
+    uint16_t birth;
+    uint16_t survival;
+    uint32_t reserved;
+    uint64_t generation; // of the current board
+    uint64_t current;    // board holding it, 0 or 1
+    uint64_t rows_done;  // rows of the next generation in the other board
+
+    uint64_t board_bytes() const { return align_page(height * stride * sizeof(word_t)); }
+    uint64_t file_bytes() const { return PAGE + 2 * board_bytes(); }
+};
+
+void MappedGrid::create(const std::string& path, size_t w, size_t h, const Rule& rule) {
+    static_assert(sizeof(Header) <= PAGE, "the header takes one page");
+    Header header{MAGIC, w, h, Grid(w, 0).get_stride(), rule.birth, rule.survival, 0, 0, 0, 0};
+    const int fd = open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw os_error("open " + path);
+    }
+    // the boards start out as holes, reading back as zeros
+    if (ftruncate(fd, header.file_bytes()) != 0) {
+        const std::runtime_error e = os_error("ftruncate " + path);
+        close(fd);
+        unlink(path.c_str());
+        throw e;
+    }
+    try {
+        write_all(fd, &header, sizeof(header), 0);
+    }
+    catch (...) {
+        close(fd);
+        unlink(path.c_str());
+        throw;
+    }
+    fsync(fd);
+    close(fd);
+}
+
+void MappedGrid::create(const std::string& path, const GridView& g) {
+    create(path, g.get_width(), g.get_height(), g.get_rule());
+    const int fd = open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        throw os_error("open " + path);
+    }
+    // a window of a grid is shifted into rows of its own first
+    const Grid rows(g);
+    const size_t row_bytes = rows.get_stride() * sizeof(word_t);
+    try {
+        for (size_t y = 0; y < rows.get_height(); ++y) {
+            write_all(fd, rows.row(y), row_bytes, PAGE + y * row_bytes);
+        }
+    }
+    catch (...) {
+        close(fd);
+        unlink(path.c_str());
+        throw;
+    }
+    fsync(fd);
+    close(fd);
+}
+
+MappedGrid::MappedGrid(const std::string& path): fd(-1), map(nullptr), bytes(0), header(nullptr), checkpoint_rows(0) {
+    fd = open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        throw os_error("open " + path);
+    }
+    Header h;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != ssize_t(sizeof(h)) ||
+        h.magic != MAGIC || h.current > 1 || h.rows_done >= std::max<uint64_t>(h.height, 1) ||
+        uint64_t(st.st_size) < h.file_bytes()) {
+        close(fd);
+        throw std::runtime_error("Not a board file: " + path);
+    }
+    bytes = h.file_bytes();
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        const std::runtime_error e = os_error("mmap " + path);
+        close(fd);
+        throw e;
+    }
+    map = static_cast<char*>(p);
+    header = reinterpret_cast<Header*>(map);
+}
+
+MappedGrid::~MappedGrid() {
+    munmap(map, bytes);
+    close(fd);
+}
+
+size_t MappedGrid::get_width() const { return header->width; }
+size_t MappedGrid::get_height() const { return header->height; }
+Rule MappedGrid::get_rule() const { return Rule{header->birth, header->survival}; }
+uint64_t MappedGrid::get_generation() const { return header->generation; }
+size_t MappedGrid::get_rows_done() const { return header->rows_done; }
+
+uint64_t MappedGrid::board_offset(uint64_t i) const {
+    return PAGE + i * header->board_bytes();
+}
+
+const word_t* MappedGrid::board(uint64_t i) const {
+    return reinterpret_cast<const word_t*>(map + board_offset(i));
+}
+
+bool MappedGrid::get_cell(size_t x, size_t y) const {
+    const word_t* row = board(header->current) + y * header->stride;
+    return (row[x / Grid::WORD_BITS] >> (x % Grid::WORD_BITS)) & 1;
+}
+
+void MappedGrid::set_cell(size_t x, size_t y, bool state) {
+    word_t* row = const_cast<word_t*>(board(header->current)) + y * header->stride;
+    const word_t bit = word_t(1) << (x % Grid::WORD_BITS);
+    if (state) row[x / Grid::WORD_BITS] |= bit;
+    else row[x / Grid::WORD_BITS] &= ~bit;
+    if (header->rows_done != 0) {
+        header->rows_done = 0;
+        write_header();
+    }
+}
+
+Grid MappedGrid::read_rows(size_t y0, size_t rows) const {
+    if (y0 + rows > header->height) {
+        throw std::runtime_error("Rows past the end of the board.");
+    }
+    Grid g(header->width, rows);
+    g.set_rule(get_rule());
+    const word_t* src = board(header->current) + y0 * header->stride;
+    for (size_t y = 0; y < rows; ++y, src += header->stride) {
+        std::copy(src, src + header->stride, g.row(y));
+    }
+    return g;
+}
+
+GridView MappedGrid::view() const {
+    return GridView(board(header->current), header->width, header->height, header->stride, get_rule());
+}
+
+void MappedGrid::sync() {
+    if (msync(map, bytes, MS_SYNC) != 0) {
+        throw os_error("msync");
+    }
+}
+
+void MappedGrid::write_header() {
+    if (msync(map, PAGE, MS_SYNC) != 0) {
+        throw os_error("msync");
+    }
+}
+
+uint64_t MappedGrid::advance(uint64_t n, const std::atomic<bool>* stop) {
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    uint64_t read0, written0;
+    disk_bytes(read0, written0);
+    stats = MappedStats();
+
+    while (stats.generations < n && step(stop)) {
+        stats.generations++;
+    }
+
+    uint64_t read1, written1;
+    disk_bytes(read1, written1);
+    stats.disk_read_bytes = read1 - read0;
+    stats.disk_written_bytes = written1 - written0;
+    stats.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    return stats.generations;
+}
+
+bool MappedGrid::step(const std::atomic<bool>* stop) {
+    const size_t width = header->width;
+    const size_t height = header->height;
+    const size_t stride = header->stride;
+    const size_t words = (width + Grid::WORD_BITS - 1) / Grid::WORD_BITS;
+    const size_t row_bytes = stride * sizeof(word_t);
+    const Rule rule = get_rule();
+    const kernels::row_fn kernel = kernels::row_kernel(rule);
+    if (height == 0) {
+        header->generation++;
+        write_header();
+        return true;
+    }
+
+    const word_t* src = board(header->current);
+    const uint64_t dst = board_offset(header->current ^ 1);
+    const size_t chunk = std::min(height, checkpoint_rows ? checkpoint_rows
+                                                          : std::max<size_t>(1, DEFAULT_CHECKPOINT_BYTES / row_bytes));
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const uintptr_t src_begin = reinterpret_cast<uintptr_t>(src);
+    madvise(const_cast<word_t*>(src), height * row_bytes, MADV_SEQUENTIAL);
+
+    // the window: rows y-1, y and y+1 of the current board, and row 0 again for the last row
+    std::vector<word_t, AlignedAllocator<word_t>> window(4 * stride);
+    word_t* up = window.data();
+    word_t* mid = up + stride;
+    word_t* down = mid + stride;
+    word_t* first = down + stride;
+    std::vector<word_t, AlignedAllocator<word_t>> out(chunk * stride);
+    auto load = [&](size_t y, word_t* to) {
+        std::memcpy(to, src + y * stride, row_bytes);
+        stats.bytes_read += row_bytes;
+    };
+
+    size_t y = header->rows_done;
+    load(0, first);
+    load((y + height - 1) % height, up);
+    if (y == 0) std::memcpy(mid, first, row_bytes);
+    else load(y, mid);
+    if (y + 1 == height) std::memcpy(down, first, row_bytes);
+    else load(y + 1, down);
+
+    size_t chunk_begin = y;
+    uintptr_t dropped = src_begin;
+    for (; y < height; ++y) {
+        kernel(up, mid, down, out.data() + (y - chunk_begin) * stride, width, 0, words, rule);
+        stats.rows++;
+        std::swap(up, mid);
+        std::swap(mid, down);
+        if (y + 2 < height) load(y + 2, down);
+        else if (y + 2 == height) std::memcpy(down, first, row_bytes);
+
+        if (y + 1 - chunk_begin < chunk && y + 1 < height) {
+            continue;
+        }
+        // write the chunk out, let go of the rows it was computed from, and checkpoint
+        write_all(fd, out.data(), (y + 1 - chunk_begin) * row_bytes, dst + chunk_begin * row_bytes);
+        stats.bytes_written += (y + 1 - chunk_begin) * row_bytes;
+        const uintptr_t behind = (src_begin + y * row_bytes) / page * page;
+        if (behind > dropped) {
+            madvise(reinterpret_cast<void*>(dropped), behind - dropped, MADV_DONTNEED);
+            dropped = behind;
+        }
+        const auto syncing = std::chrono::steady_clock::now();
+        if (fdatasync(fd) != 0) {
+            throw os_error("fdatasync");
+        }
+        if (y + 1 == height) {
+            header->current ^= 1;
+            header->generation++;
+            header->rows_done = 0;
+        }
+        else {
+            header->rows_done = y + 1;
+        }
+        write_header();
+        stats.sync_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - syncing).count();
+        stats.checkpoints++;
+        chunk_begin = y + 1;
+
+        if (y + 1 < height && stop != nullptr && stop->load()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#else
+
+struct MappedGrid::Header {};
+
+void MappedGrid::create(const std::string&, size_t, size_t, const Rule&) {
+    throw std::runtime_error("Memory-mapped boards are not supported on this platform.");
+}
+
+void MappedGrid::create(const std::string&, const GridView&) {
+    throw std::runtime_error("Memory-mapped boards are not supported on this platform.");
+}
+
+MappedGrid::MappedGrid(const std::string&): fd(-1), map(nullptr), bytes(0), header(nullptr), checkpoint_rows(0) {
+    throw std::runtime_error("Memory-mapped boards are not supported on this platform.");
+}
+
+MappedGrid::~MappedGrid() {}
+
+size_t MappedGrid::get_width() const { return 0; }
+size_t MappedGrid::get_height() const { return 0; }
+Rule MappedGrid::get_rule() const { return rules::CONWAY; }
+uint64_t MappedGrid::get_generation() const { return 0; }
+size_t MappedGrid::get_rows_done() const { return 0; }
+bool MappedGrid::get_cell(size_t, size_t) const { return false; }
+void MappedGrid::set_cell(size_t, size_t, bool) {}
+Grid MappedGrid::read_rows(size_t, size_t) const { return Grid(0, 0); }
+GridView MappedGrid::view() const { return GridView(nullptr, 0, 0, 0); }
+void MappedGrid::sync() {}
+uint64_t MappedGrid::advance(uint64_t, const std::atomic<bool>*) { return 0; }
+bool MappedGrid::step(const std::atomic<bool>*) { return false; }
+void MappedGrid::write_header() {}
+const word_t* MappedGrid::board(uint64_t) const { return nullptr; }
+uint64_t MappedGrid::board_offset(uint64_t) const { return 0; }
+
+#endif
@@ -4,158 +4,388 @@
 #include <sstream>
 #include <cctype>
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CGOL_HAVE_MMAP 1
+#endif
+
+namespace {
+
+// takes the next line off text, without its line break
+std::string_view next_line(std::string_view& text) {
+    const char* end = static_cast<const char*>(std::memchr(text.data(), '\n', text.size()));
+    const size_t n = end ? end - text.data() : text.size();
+    std::string_view line = text.substr(0, n);
+    text.remove_prefix(end ? n + 1 : n);
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+    return s;
+}
+
+// parses an integer at the start of s after any blanks, and takes it off s
+template <typename T>
+bool take_number(std::string_view& s, T& value) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc()) {
+        return false;
+    }
+    s.remove_prefix(end - s.data());
+    return true;
+}
+
+std::string read_all(std::iostream& ios) {
+    std::stringstream buffer;
+    buffer << ios.rdbuf();
+    return buffer.str();
+}
+
+struct RLE_Header {
+    size_t width = 0;
+    size_t height = 0;
+    Rule rule = rules::CONWAY;
+};
+
+// "x = m, y = n, rule = ..."
+RLE_Header parse_header(std::string_view line) {
+    RLE_Header header;
+    while (!line.empty()) {
+        const size_t comma = line.find(',');
+        const std::string_view token = line.substr(0, comma);
+        line.remove_prefix(comma == std::string_view::npos ? line.size() : comma + 1);
+
+        const size_t equals = token.find('=');
+        if (equals == std::string_view::npos) {
+            continue;
+        }
+        const std::string_view key = trim(token.substr(0, equals));
+        std::string_view value = trim(token.substr(equals + 1));
+        if (key == "x" || key == "y") {
+            size_t n = 0;
+            if (!take_number(value, n)) {
+                throw std::runtime_error("Invalid RLE header.");
+            }
+            (key == "x" ? header.width : header.height) = n;
+        }
+        else if (key == "rule") {
+            // drop a bounded-grid suffix such as ":T100,100", the grid is a torus anyway
+            header.rule = Rule::parse(std::string(value.substr(0, value.find(':'))));
+        }
+    }
+    return header;
+}
+
+// Assembles output in a large buffer and hands it to the stream in big writes,
+// instead of an insertion, and with std::endl a flush, per token.
+class Output {
+public:
+    static constexpr size_t CAPACITY = size_t(1) << 20;
+
+    explicit Output(std::ostream& os): os(os) { buffer.reserve(CAPACITY); }
+    ~Output() { flush(); }
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    void put(char c) {
+        buffer.push_back(c);
+        if (buffer.size() >= CAPACITY) flush();
+    }
+    void put(std::string_view s) {
+        buffer.append(s);
+        if (buffer.size() >= CAPACITY) flush();
+    }
+    void put(uint64_t n) {
+        char digits[20];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), n);
+        put(std::string_view(digits, result.ptr - digits));
+    }
+    void flush() {
+        os.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+private:
+    std::ostream& os;
+    std::string buffer;
+};
+
+size_t count_digits(uint64_t n) {
+    size_t digits = 1;
+    while (n >= 10) {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+// The bytes of a file, mapped read-only where the OS can and read in whole
+// where it cannot.
+class FileBytes {
+public:
+    explicit FileBytes(const std::string& filename) {
+#ifdef CGOL_HAVE_MMAP
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("File failed to open.");
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                map = static_cast<const char*>(p);
+                size = st.st_size;
+            }
+        }
+        close(fd);
+        if (map) {
+            return;
+        }
+#endif
+        std::fstream file(filename, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("File failed to open.");
+        }
+        copy = read_all(file);
+    }
+
+    ~FileBytes() {
+#ifdef CGOL_HAVE_MMAP
+        if (map) {
+            munmap(const_cast<char*>(map), size);
+        }
+#endif
+    }
+
+    FileBytes(const FileBytes&) = delete;
+    FileBytes& operator=(const FileBytes&) = delete;
+
+    std::string_view text() const {
+        return map ? std::string_view(map, size) : std::string_view(copy);
+    }
+
+private:
+    const char* map = nullptr;
+    size_t size = 0;
+    std::string copy;
+};
+
+} // namespace
 
 // https://conwaylife.com/wiki/Run_Length_Encoded
 Grid RLE_Parser::read() {
     std::string line;
     // pass comments before header
     while (getline(ios, line)) {
-        if (line.front() != COMMENT_TAG)
+        if (!line.empty() && line.front() != COMMENT_TAG)
             break;
     }
+    const RLE_Header header = parse_header(line);
 
-    std::stringstream header(line);
-
-    std::string token;
-    int width = 0;
-    int height = 0;
-    std::string rule;
+    // RLE, decoded in chunks straight into the grid
+    Grid result(header.width, header.height);
+    result.set_rule(header.rule);
+    RLE_Decoder decoder(result);
+    std::vector<char> buffer(READ_CHUNK);
+    while (!decoder.finished()) {
+        ios.read(buffer.data(), buffer.size());
+        const std::streamsize n = ios.gcount();
+        if (n <= 0) {
+            break;
+        }
+        decoder.feed(buffer.data(), n);
+    }
+    if (!decoder.finished()) {
+        std::cout << "Warning: Ending '!' not found." << std::endl;
+    }
+    return result;
+}
 
-    // parse header
-    while (std::getline(header, token, ',')) {
-        std::stringstream tokenStream(token);
-        std::string key;
-        std::string value;
+Grid RLE_Parser::parse(std::string_view text) {
+    std::string_view line;
+    while (!text.empty()) {
+        line = next_line(text);
+        if (!line.empty() && line.front() != COMMENT_TAG)
+            break;
+    }
+    const RLE_Header header = parse_header(line);
 
-        if (std::getline(tokenStream, key, '=') && std::getline(tokenStream, value)) {
-            if (key.find("x") != std::string::npos) {
-                width = std::stoi(value);
-            } else if (key.find("y") != std::string::npos) {
-                height = std::stoi(value);
-            } else if (key.find("rule") != std::string::npos) {
-                rule = value;
-            }
-        }
+    // the rest is decoded in one go
+    Grid result(header.width, header.height);
+    result.set_rule(header.rule);
+    RLE_Decoder decoder(result);
+    decoder.feed(text.data(), text.size());
+    if (!decoder.finished()) {
+        std::cout << "Warning: Ending '!' not found." << std::endl;
     }
+    return result;
+}
 
-    std::vector<std::vector<bool>> temp_grid;
-    std::vector<bool> current_line;
+bool RLE_Decoder::feed(const char* data, size_t n) {
+    // the state in locals, which stores to the rows cannot alias
+    uint64_t cx = x;
+    uint64_t cy = y;
+    uint64_t count = run;
+    Grid::word_t* r = row;
+    const uint64_t width = grid.get_width();
+    const uint64_t height = grid.get_height();
 
-    // RLE
-    char ch;
-    int run_length = 0;
-    while (ios.get(ch)) {
-        // if digit add to run length
+    const char* end = data + n;
+    const char* p = data;
+    for (; p < end && !done; ++p) {
+        const char ch = *p;
         if (ch >= '0' && ch <= '9') {
-            // run_length * 10 for multi digit run length
-            run_length = run_length * 10 + (ch - '0');
+            // saturates rather than wraps; anything that long is clipped anyway
+            count = count < MAX_RUN ? count * 10 + (ch - '0') : MAX_RUN;
+            continue;
         }
-        else {
-            // when run length is omitted
-            if (run_length == 0) {
-                run_length = 1;
-            }
-            switch (ch) {
-            case LIVE_TAG:
-                for (int i = 0; i < run_length; ++i) {
-                    current_line.push_back(LIVE);
-                }
-                break;
-            case DEAD_TAG:
-                for (int i = 0; i < run_length; ++i) {
-                    current_line.push_back(DEAD);
-                }
-                break;
-            case EOL_TAG:
-                temp_grid.push_back(current_line);
-                current_line.clear();
-                break;
-            case END_TAG:
-                if (!current_line.empty()) {
-                    temp_grid.push_back(current_line);
-                }
-                return Grid(width, height, temp_grid);
-            default:
-                throw std::runtime_error("Invalid token.");
+        const uint64_t length = count ? std::min(count, MAX_RUN) : 1;
+        count = 0;
+        switch (ch) {
+        case RLE_Parser::LIVE_TAG:
+            if (cy < height && cx < width) {
+                if (!r) r = grid.row(cy);
+                fill(r, cx, cx + std::min(length, width - cx));
             }
-            run_length = 0;
+            cx += length;
+            break;
+        case RLE_Parser::DEAD_TAG:
+            cx += length;
+            break;
+        case RLE_Parser::EOL_TAG:
+            cy += length;
+            cx = 0;
+            r = nullptr;
+            break;
+        case RLE_Parser::END_TAG:
+            done = true;
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            break;
+        default:
+            throw std::runtime_error("Invalid token.");
         }
     }
-    std::cout << "Warning: Ending '!' not found." << std::endl;
-    if (!current_line.empty()) {
-        temp_grid.push_back(current_line);
+    x = cx;
+    y = cy;
+    run = count;
+    row = r;
+    return !done;
+}
+
+void RLE_Decoder::fill(Grid::word_t* row, size_t begin, size_t end) {
+    size_t i = begin / Grid::WORD_BITS;
+    const size_t last = (end - 1) / Grid::WORD_BITS;
+    const Grid::word_t head = ~Grid::word_t(0) << (begin % Grid::WORD_BITS);
+    const Grid::word_t tail = ~Grid::word_t(0) >> (Grid::WORD_BITS - 1 - (end - 1) % Grid::WORD_BITS);
+    if (i == last) {
+        row[i] |= head & tail;
+        return;
+    }
+    row[i] |= head;
+    for (++i; i < last; ++i) {
+        row[i] = ~Grid::word_t(0);
     }
-    return Grid(width, height, temp_grid);
+    row[last] |= tail;
 }
 
-void RLE_Parser::save(const Grid& g) {
-    
+void RLE_Parser::save(const GridView& g) {
+    Output out(ios);
+
     // header
-    ios << "x = " << g.get_width() << ", y = " << g.get_height() << std::endl;
+    out.put("x = ");
+    out.put(uint64_t(g.get_width()));
+    out.put(", y = ");
+    out.put(uint64_t(g.get_height()));
+    out.put(", rule = ");
+    out.put(g.get_rule().to_string());
+    out.put('\n');
 
-    // RLE
+    // RLE, wrapped before a token would run past LINE_WIDTH
+    size_t column = 0;
+    auto token = [&](uint64_t n, char tag) {
+        const size_t length = (n > 1 ? count_digits(n) : 0) + 1;
+        if (column + length > LINE_WIDTH) {
+            out.put('\n');
+            column = 0;
+        }
+        if (n > 1) {
+            out.put(n);
+        }
+        out.put(tag);
+        column += length;
+    };
+
+    // only live runs are walked: dead runs are the gaps between them, and dead
+    // cells ending a row and rows ending the pattern are left out
+    uint64_t lines = 0; // row ends owed before the next run
     for (size_t y = 0; y < g.get_height(); ++y) {
-        int run_length = 1;
-        bool prev = g.get_cell(0,y);
-        for (size_t x = 1; x < g.get_width(); ++x) {
-            if (g.get_cell(x, y) != prev) {
-                if (run_length != 1) {
-                    ios << std::to_string(run_length);
-                }
-                if (prev == LIVE) {
-                    ios << LIVE_TAG;
-                }
-                else {
-                    ios << DEAD_TAG;
-                }
-                run_length = 1;
-                prev = g.get_cell(x, y);
+        size_t x = 0;
+        g.for_each_run(y, [&](size_t begin, size_t end) {
+            if (lines) {
+                token(lines, EOL_TAG);
+                lines = 0;
             }
-            else {
-                run_length++;
+            if (begin > x) {
+                token(begin - x, DEAD_TAG);
             }
-        }
-        if (run_length != 1) {
-            ios << std::to_string(run_length);
-        }
-        if (prev == LIVE) {
-            ios << LIVE_TAG;
-        }
-        else {
-            ios << DEAD_TAG;
-        }
-        ios << EOL_TAG;
+            token(end - begin, LIVE_TAG);
+            x = end;
+        });
+        lines++;
     }
-    ios << END_TAG;
+    token(1, END_TAG);
+    out.put('\n');
 }
 
 // https://conwaylife.com/wiki/Plaintext
 Grid Plaintext_Parser::read() {
-    std::string line;
-    std::vector<std::string> lines;
-    int w = 0;
-    int h = 0;
+    return parse(read_all(ios));
+}
 
-    // creating the grid
-    while (getline(ios, line)) {
-        if (line.front() != COMMENT_TAG) {
-            w = line.size();
+Grid Plaintext_Parser::parse(std::string_view text) {
+    // size the grid: rows are the lines other than comments, as wide as the widest
+    size_t w = 0;
+    size_t h = 0;
+    for (std::string_view rest = text; !rest.empty();) {
+        const std::string_view line = next_line(rest);
+        if (line.empty() || line.front() != COMMENT_TAG) {
+            w = std::max(w, line.size());
             h++;
-            lines.push_back(line);
         }
     }
-    Grid result(w,h);
+    Grid result(w, h);
 
-    //set the cells
-    int y = 0;
-    for (const auto& line : lines) {
-        for (int x = 0; x < w; x++) {
-            if (line[x] == LIVE_SYMBOL) {
-                result.set_cell(x, y, LIVE);
-            }
-            else if (line[x] == DEAD_SYMBOL) {
-                result.set_cell(x, y, DEAD);
-            }
+    // set the cells, finding live ones with memchr; dead ones are there already
+    size_t y = 0;
+    while (!text.empty()) {
+        const std::string_view line = next_line(text);
+        if (!line.empty() && line.front() == COMMENT_TAG) {
+            continue;
+        }
+        const char* p = line.data();
+        const char* end = p + line.size();
+        while ((p = static_cast<const char*>(std::memchr(p, LIVE_SYMBOL, end - p)))) {
+            result.set_cell(p - line.data(), y, LIVE);
+            ++p;
         }
         y++;
     }
@@ -163,61 +393,70 @@ Grid Plaintext_Parser::read() {
     return result;
 }
 
-void Plaintext_Parser::save(const Grid& g) {
-    for (size_t i = 0; i < g.get_height(); i++){
-        for (size_t j = 0; j < g.get_width(); j++){
-            if (g.get_cell(j,i) == LIVE){
-                ios << LIVE_SYMBOL;
-            }
-            else if (g.get_cell(j,i) == DEAD){
-                ios << DEAD_SYMBOL;
-            }
-        }
-        ios << std::endl;
+void Plaintext_Parser::save(const GridView& g) {
+    Output out(ios);
+    std::string line(g.get_width() + 1, DEAD_SYMBOL);
+    line.back() = '\n';
+    for (size_t y = 0; y < g.get_height(); ++y) {
+        std::fill(line.begin(), line.end() - 1, DEAD_SYMBOL);
+        g.for_each_live(y, [&](size_t x) { line[x] = LIVE_SYMBOL; });
+        out.put(line);
     }
 }
 
 // https://conwaylife.com/wiki/Life_1.06
 Grid Life106_Parser::read() {
-    std::string line;
-    std::vector<int> x;
-    std::vector<int> y;
-    
-    // skip header
-    getline(ios, line);
+    return parse(read_all(ios));
+}
 
-    // creating the grid
-    while (getline(ios, line)) {
-        std::stringstream ss(line);
-        int x_coord;
-        int y_coord;
-        ss >> x_coord >> y_coord;
-        x.push_back(x_coord);
-        y.push_back(y_coord);
-    }
-    int minX = *std::min_element(x.begin(), x.end());
-    int minY = *std::min_element(y.begin(), y.end());
-    int maxX = *std::max_element(x.begin(), x.end());
-    int maxY = *std::max_element(y.begin(), y.end());
-    int h = maxY - minY + 1;
-    int w = maxX - minX + 1;
-    Grid result(w,h);
+Grid Life106_Parser::parse(std::string_view text) {
+    std::vector<std::pair<long long, long long>> cells;
+    while (!text.empty()) {
+        std::string_view line = next_line(text);
+        // the "#Life 1.06" header and any other # lines
+        if (trim(line).empty() || line.front() == '#') {
+            continue;
+        }
+        long long x;
+        long long y;
+        if (!take_number(line, x) || !take_number(line, y)) {
+            throw std::runtime_error("Invalid coordinates.");
+        }
+        cells.emplace_back(x, y);
+    }
+    if (cells.empty()) {
+        return Grid(0, 0);
+    }
+
+    long long minX = cells[0].first;
+    long long minY = cells[0].second;
+    long long maxX = minX;
+    long long maxY = minY;
+    for (const auto& [x, y] : cells) {
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+    }
+    Grid result(maxX - minX + 1, maxY - minY + 1);
 
     //set the cells
-    for (size_t count = 0; count < x.size(); count++) {
-        result.set_cell(x[count] - minX, y[count] - minY, LIVE);
+    for (const auto& [x, y] : cells) {
+        result.set_cell(x - minX, y - minY, LIVE);
     }
     return result;
 }
 
-void Life106_Parser::save(const Grid& g) {
-    ios << "#Life 1.06" << std::endl;
-    for (size_t i = 0; i < g.get_height(); i++){
-        for (size_t j = 0; j < g.get_width(); j++){
-            if (g.get_cell(j,i) == LIVE){
-                ios << j << " " << i << std::endl;
-            }
-        }
+void Life106_Parser::save(const GridView& g) {
+    Output out(ios);
+    out.put("#Life 1.06\n");
+    for (size_t y = 0; y < g.get_height(); ++y) {
+        g.for_each_live(y, [&](size_t x) {
+            out.put(uint64_t(x));
+            out.put(' ');
+            out.put(uint64_t(y));
+            out.put('\n');
+        });
     }
 }
 
@@ -230,36 +469,34 @@ std::string FileHandler::get_extension(std::string filename) {
 
 Grid FileHandler::read(std::string filename) {
 
-    std::fstream file(filename);
-
-    if (!file.is_open()) {
-        throw std::runtime_error("File failed to open.");
-    }
+    const FileBytes file(filename);
     
     std::string ext = get_extension(filename);
-    std::unique_ptr<Parser> parser;
 
     if (ext == "rle") {
-        parser = std::make_unique<RLE_Parser>(file);
+        return RLE_Parser::parse(file.text());
     }
     else if (ext == "txt") {
-        parser = std::make_unique<Plaintext_Parser>(file);
+        return Plaintext_Parser::parse(file.text());
     }
     else if (ext == "life" || ext == "lif") {
-        parser = std::make_unique<Life106_Parser>(file);
+        return Life106_Parser::parse(file.text());
     }
     else {
         throw std::runtime_error("Unsupported file format.");
     }
-    
-    Grid result = parser->read();
-
-    file.close();
+}
 
+Grid FileHandler::read_centered(std::string filename, size_t w, size_t h) {
+    const Grid pattern = read(filename);
+    Grid result(w, h);
+    // place_center() copies cells only
+    result.set_rule(pattern.get_rule());
+    result.place_center(pattern);
     return result;
 }
 
-void FileHandler::save(const Grid& g, std::string filename) {
+void FileHandler::save(const GridView& g, std::string filename) {
     
     std::fstream file(filename, std::ios::out);
 
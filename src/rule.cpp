@@ -0,0 +1,70 @@
+#include "rule.hpp"
+
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+// reads neighbour counts up to the next '/', returning them as a bit set
+uint16_t parse_counts(const std::string& text, size_t& i) {
+    uint16_t counts = 0;
+    for (; i < text.size() && text[i] != '/'; ++i) {
+        if (text[i] < '0' || text[i] > '8') {
+            throw std::runtime_error("Invalid rule: " + text);
+        }
+        counts |= uint16_t(1) << (text[i] - '0');
+    }
+    return counts;
+}
+
+} // namespace
+
+Rule Rule::parse(const std::string& text) {
+    std::string s;
+    for (char ch : text) {
+        if (!std::isspace(static_cast<unsigned char>(ch))) {
+            s += std::toupper(static_cast<unsigned char>(ch));
+        }
+    }
+    const size_t slash = s.find('/');
+    if (s.empty() || slash == std::string::npos || s.find('/', slash + 1) != std::string::npos) {
+        throw std::runtime_error("Invalid rule: " + text);
+    }
+
+    Rule rule{0, 0};
+    size_t i = 0;
+    if (s[0] == 'B' || s[0] == 'S') {
+        bool seen[2] = {false, false};
+        while (i < s.size()) {
+            const char tag = s[i++];
+            if ((tag != 'B' && tag != 'S') || seen[tag == 'S']) {
+                throw std::runtime_error("Invalid rule: " + text);
+            }
+            seen[tag == 'S'] = true;
+            (tag == 'B' ? rule.birth : rule.survival) = parse_counts(s, i);
+            if (i < s.size()) ++i; // skip '/'
+        }
+        if (!seen[0] || !seen[1]) {
+            throw std::runtime_error("Invalid rule: " + text);
+        }
+    }
+    else {
+        // survival/birth
+        rule.survival = parse_counts(s, i);
+        ++i;
+        rule.birth = parse_counts(s, i);
+    }
+    return rule;
+}
+
+std::string Rule::to_string() const {
+    std::string s = "B";
+    for (int k = 0; k <= 8; ++k) {
+        if ((birth >> k) & 1) s += char('0' + k);
+    }
+    s += "/S";
+    for (int k = 0; k <= 8; ++k) {
+        if ((survival >> k) & 1) s += char('0' + k);
+    }
+    return s;
+}
@@ -0,0 +1,69 @@
+#include "scheduler.hpp"
+
+#include <chrono>
+
+WorkStealingScheduler::WorkStealingScheduler(size_t threads, bool pin):
+    pool(threads, pin), queues(new Queue[pool.size()]), stats(pool.size(), WorkerStats{0, 0, 0}), seconds(0) {}
+
+bool WorkStealingScheduler::pop(size_t worker, size_t& task) {
+    Queue& q = queues[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = q.tasks.front();
+    q.tasks.pop_front();
+    return true;
+}
+
+// takes the task the victim would reach last, trying every other worker once
+bool WorkStealingScheduler::steal(size_t thief, size_t& task) {
+    const size_t n = pool.size();
+    for (size_t k = 1; k < n; ++k) {
+        Queue& q = queues[(thief + k) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = q.tasks.back();
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingScheduler::run(size_t tasks, const std::function<void(size_t, size_t)>& fn) {
+    using clock = std::chrono::steady_clock;
+    std::lock_guard<std::mutex> serial(running);
+    const size_t n = pool.size();
+    for (size_t w = 0; w < n; ++w) {
+        queues[w].tasks.clear();
+        for (size_t t = tasks * w / n; t < tasks * (w + 1) / n; ++t) {
+            queues[w].tasks.push_back(t);
+        }
+        stats[w] = WorkerStats{0, 0, 0};
+    }
+
+    const auto start = clock::now();
+    // tasks never spawn tasks, so once no deque has any left the worker is done
+    pool.run([&](size_t worker) {
+        WorkerStats& own = stats[worker];
+        size_t task;
+        for (;;) {
+            if (!pop(worker, task)) {
+                if (!steal(worker, task)) {
+                    break;
+                }
+                own.steals++;
+            }
+            const auto begin = clock::now();
+            fn(task, worker);
+            own.busy_seconds += std::chrono::duration<double>(clock::now() - begin).count();
+            own.tasks++;
+        }
+    });
+    seconds = std::chrono::duration<double>(clock::now() - start).count();
+}
+
+double WorkStealingScheduler::utilization(size_t worker) const {
+    return seconds > 0 ? stats[worker].busy_seconds / seconds : 0;
+}
@@ -0,0 +1,148 @@
+#include "sim_runner.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+SimRunner::SimRunner(Grid g): sim(g), frames(Frame{g, 0, 0}), posted(0), completed(0), restart(false), stopping(false),
+                              playing(false), delay(sim.get_delay()), lookahead(DEFAULT_LOOKAHEAD), engine(&SimRunner::run, this) {}
+
+SimRunner::~SimRunner() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    engine.join();
+}
+
+void SimRunner::post(std::function<void(Simulation&)> command) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back(std::move(command));
+        posted++;
+    }
+    wake.notify_all();
+}
+
+void SimRunner::set_cell(size_t x, size_t y, bool state) {
+    post([=](Simulation& s) {
+        if (x < s.get_width() && y < s.get_height()) s.set_cell(x, y, state);
+    });
+}
+
+void SimRunner::reset() {
+    post([](Simulation& s) { s.reset(); });
+}
+
+void SimRunner::prev() {
+    post([](Simulation& s) {
+        if (s.get_tick() > 0) s.prev();
+    });
+}
+
+void SimRunner::next() {
+    post([](Simulation& s) { s.step(); });
+}
+
+void SimRunner::replace(const Grid& g) {
+    post([g](Simulation& s) {
+        const int d = s.get_delay();
+        s = Simulation(g);
+        s.set_delay(d);
+    });
+}
+
+void SimRunner::play() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        playing = true;
+        restart = true;
+    }
+    wake.notify_all();
+}
+
+void SimRunner::pause() {
+    std::lock_guard<std::mutex> lock(mutex);
+    playing = false;
+}
+
+void SimRunner::set_delay(int ms) {
+    delay = ms;
+    post([ms](Simulation& s) { s.set_delay(ms); });
+}
+
+void SimRunner::set_lookahead(size_t generations) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lookahead = generations;
+    }
+    wake.notify_all();
+}
+
+void SimRunner::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    const uint64_t target = posted;
+    done.wait(lock, [&] { return completed >= target || stopping; });
+}
+
+void SimRunner::publish() {
+    Frame& f = frames.write();
+    f.grid = sim.current();
+    f.tick = sim.get_tick();
+    f.generation = sim.get_generation();
+    frames.publish();
+}
+
+void SimRunner::run() {
+    using clock = std::chrono::steady_clock;
+    clock::time_point due = clock::now();
+
+    bool stuck = false; // precompute() refused, until the next command changes that
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        auto ready = [&] { return stopping || !commands.empty() || restart; };
+        // with generations left to precompute, only look for commands in between
+        const bool idle_work = !stuck && sim.get_precomputed() < lookahead;
+        if (!idle_work && playing) {
+            wake.wait_until(lock, due, ready);
+        }
+        else if (!idle_work) {
+            wake.wait(lock, [&] { return ready() || playing; });
+        }
+        if (stopping) {
+            return;
+        }
+        if (restart) {
+            due = clock::now();
+            restart = false;
+        }
+
+        std::vector<std::function<void(Simulation&)>> batch;
+        batch.swap(commands);
+        const bool step = playing && clock::now() >= due;
+        lock.unlock();
+
+        for (auto& command : batch) {
+            command(sim);
+        }
+        if (!batch.empty()) {
+            stuck = false;
+        }
+        if (step) {
+            sim.step();
+            // keep the pace without piling up steps after a slow generation
+            due = std::max(due + std::chrono::milliseconds(delay.load()), clock::now());
+        }
+        if (step || !batch.empty()) {
+            publish();
+        }
+        else if (idle_work) {
+            stuck = !sim.precompute();
+        }
+
+        lock.lock();
+        completed += batch.size();
+        done.notify_all();
+    }
+}
@@ -0,0 +1,317 @@
+#include "sparse.hpp"
+#include "kernel_impl.hpp"
+#include "bits.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+bool is_empty(const SparseUniverse::Tile& t) {
+    uint64_t any = 0;
+    for (uint64_t r : t.rows) any |= r;
+    return any == 0;
+}
+
+bool same(const SparseUniverse::Tile& a, const SparseUniverse::Tile& b) {
+    return std::memcmp(a.rows, b.rows, sizeof(a.rows)) == 0;
+}
+
+// bit of the neighbour at offset (dx, dy) in an edge mask
+unsigned direction(int dx, int dy) {
+    return 1u << ((dy + 1) * 3 + (dx + 1));
+}
+
+// the neighbouring tiles the live edge cells of t touch
+unsigned edge_mask(const SparseUniverse::Tile& t) {
+    constexpr size_t LAST = SparseUniverse::TILE_SIZE - 1;
+    uint64_t left = 0, right = 0;
+    for (uint64_t r : t.rows) {
+        left |= r & 1;
+        right |= r >> 63;
+    }
+    const uint64_t top = t.rows[0];
+    const uint64_t bottom = t.rows[LAST];
+    unsigned mask = 0;
+    if (top & 1) mask |= direction(-1, -1);
+    if (top) mask |= direction(0, -1);
+    if (top >> 63) mask |= direction(1, -1);
+    if (left) mask |= direction(-1, 0);
+    if (right) mask |= direction(1, 0);
+    if (bottom & 1) mask |= direction(-1, 1);
+    if (bottom) mask |= direction(0, 1);
+    if (bottom >> 63) mask |= direction(1, 1);
+    return mask;
+}
+
+// next generation of the rows of a tile from its columns with one row of halo
+template <class R>
+uint64_t step_rows(const uint64_t (*col)[SparseUniverse::TILE_SIZE+2], SparseUniverse::Tile& out, const Rule& rule) {
+    uint64_t any = 0;
+    for (size_t r = 1; r <= size_t(SparseUniverse::TILE_SIZE); ++r) {
+        uint64_t west[3], mid[3], east[3];
+        for (int k = 0; k < 3; ++k) {
+            const size_t i = r - 1 + k;
+            mid[k] = col[1][i];
+            west[k] = (col[1][i] << 1) | (col[0][i] >> 63);
+            east[k] = (col[1][i] >> 1) | (col[2][i] << 63);
+        }
+        out.rows[r-1] = kernels::life<R>(west[0], mid[0], east[0], west[1], mid[1], east[1], west[2], mid[2], east[2], rule);
+        any |= out.rows[r-1];
+    }
+    return any;
+}
+
+} // namespace
+
+SparseUniverse::SparseUniverse(const Rule& rule):
+    rule(rule),
+    kernel(kernels::select_rule(kernels::rule_kernel(rule), [](auto r) -> TileKernel { return step_rows<decltype(r)>; })),
+    generation(0), stats{0, 0, 0} {
+    if (rule.births_from_nothing()) {
+        throw std::runtime_error("Sparse universes do not support B0 rules: " + rule.to_string());
+    }
+}
+
+SparseUniverse::SparseUniverse(const GridView& g, int64_t x, int64_t y): SparseUniverse(g.get_rule()) {
+    for (size_t j = 0; j < g.get_height(); ++j) {
+        g.for_each_live(j, [&](size_t i) { set_cell(x + int64_t(i), y + int64_t(j), LIVE); });
+    }
+}
+
+const SparseUniverse::Slot* SparseUniverse::find(int64_t tx, int64_t ty) const {
+    auto it = tiles.find(Key{tx, ty});
+    return it == tiles.end() ? nullptr : &it->second;
+}
+
+// an empty tile that has been empty for the last two generations as well
+SparseUniverse::Slot& SparseUniverse::insert(const Key& key) {
+    auto it = tiles.find(key);
+    if (it == tiles.end()) {
+        Slot empty;
+        std::memset(&empty, 0, sizeof(empty));
+        it = tiles.emplace(key, empty).first;
+    }
+    return it->second;
+}
+
+bool SparseUniverse::get_cell(int64_t x, int64_t y) const {
+    const Slot* s = find(tile_of(x), tile_of(y));
+    return s && ((s->now().rows[bit_of(y)] >> bit_of(x)) & 1);
+}
+
+void SparseUniverse::set_cell(int64_t x, int64_t y, bool state) {
+    const Key key{tile_of(x), tile_of(y)};
+    if (!state && !find(key.x, key.y)) {
+        return;
+    }
+    Slot& s = insert(key);
+    uint64_t& row = s.buf[s.cur].rows[bit_of(y)];
+    if (state) {
+        row |= uint64_t(1) << bit_of(x);
+    }
+    else {
+        row &= ~(uint64_t(1) << bit_of(x));
+    }
+    // the previous generation no longer leads here, so nothing may be skipped
+    s.changed = true;
+    s.changed2 = true;
+    s.edited = true;
+    active.push_back(key);
+}
+
+bool SparseUniverse::edge_reaches(const Key& from, int dx, int dy) const {
+    const Slot* s = find(from.x, from.y);
+    return s && (edge_mask(s->now()) & direction(dx, dy));
+}
+
+// Computes the next generation of one tile from its 3x3 neighbourhood (missing
+// tiles are dead) with the bitsliced kernel. Returns whether any cell lives.
+bool SparseUniverse::step_tile(int64_t tx, int64_t ty, Tile& out) const {
+    constexpr size_t N = TILE_SIZE;
+    const Slot* around[3][3];
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            around[dy+1][dx+1] = find(tx + dx, ty + dy);
+        }
+    }
+
+    // columns of the west, center and east tiles, one row of halo above and below
+    uint64_t col[3][N+2];
+    for (int c = 0; c < 3; ++c) {
+        const Slot* n = around[0][c];
+        const Slot* m = around[1][c];
+        const Slot* s = around[2][c];
+        col[c][0] = n ? n->now().rows[N-1] : 0;
+        for (size_t r = 0; r < N; ++r) col[c][r+1] = m ? m->now().rows[r] : 0;
+        col[c][N+1] = s ? s->now().rows[0] : 0;
+    }
+
+    return kernel(col, out, rule) != 0;
+}
+
+void SparseUniverse::step() {
+    const uint64_t stamp = generation + 1;
+
+    // Births outside the stored tiles can only come from live edges, and a live
+    // edge can only appear when a tile changes: give those edges a neighbour.
+    for (size_t i = 0; i < active.size(); ++i) {
+        const Slot& s = tiles.at(active[i]);
+        if (!s.changed) continue;
+        const unsigned mask = edge_mask(s.now());
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                if (mask & direction(dx, dy)) {
+                    insert(Key{active[i].x + dx, active[i].y + dy});
+                }
+            }
+        }
+    }
+
+    // Tiles outside the neighbourhood of a recent change are stable and are not
+    // even visited. Decisions read the flags of the current generation, so new
+    // states and flags are only applied once every visited tile is decided.
+    struct Update {
+        Slot* slot;
+        bool flip;
+        bool changed;
+        bool changed2;
+    };
+    std::vector<Key> visited;
+    std::vector<Update> updates;
+    for (const Key& a : active) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                auto it = tiles.find(Key{a.x + dx, a.y + dy});
+                if (it != tiles.end() && it->second.stamp != stamp) {
+                    it->second.stamp = stamp;
+                    visited.push_back(it->first);
+                }
+            }
+        }
+    }
+
+    stats = StepStats{0, 0, tiles.size()};
+    Tile out;
+    for (const Key& key : visited) {
+        Slot& s = tiles.at(key);
+        bool changed = false;
+        bool changed2 = false;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                if (const Slot* n = find(key.x + dx, key.y + dy)) {
+                    changed |= n->changed;
+                    changed2 |= n->changed2;
+                }
+            }
+        }
+
+        if (!changed) {
+            // same neighbourhood as one generation ago: same state
+            updates.push_back(Update{&s, false, false, false});
+        }
+        else if (!changed2) {
+            // same neighbourhood as two generations ago: the state of one generation ago
+            updates.push_back(Update{&s, true, s.changed, false});
+            stats.flipped++;
+        }
+        else {
+            step_tile(key.x, key.y, out);
+            Tile& prev = s.buf[1 - s.cur];
+            updates.push_back(Update{&s, true, !same(out, s.now()), s.edited || !same(out, prev)});
+            prev = out;
+            stats.computed++;
+        }
+    }
+    stats.skipped -= stats.computed + stats.flipped;
+
+    for (const Update& u : updates) {
+        if (u.flip) u.slot->cur = 1 - u.slot->cur;
+        u.slot->changed = u.changed;
+        u.slot->changed2 = u.changed2;
+        u.slot->edited = false;
+    }
+    generation++;
+
+    // Keep tracking visited tiles that are still changing. Drop the ones that have
+    // been empty for three generations, unless a live edge next door still
+    // borders them (the edge pass above would not recreate them).
+    active.clear();
+    for (const Key& key : visited) {
+        auto it = tiles.find(key);
+        const Slot& s = it->second;
+        if (s.active()) {
+            active.push_back(key);
+            continue;
+        }
+        if (!is_empty(s.now())) {
+            continue;
+        }
+        bool bordered = false;
+        for (int dy = -1; dy <= 1 && !bordered; ++dy) {
+            for (int dx = -1; dx <= 1 && !bordered; ++dx) {
+                bordered = (dx || dy) && edge_reaches(Key{key.x + dx, key.y + dy}, -dx, -dy);
+            }
+        }
+        if (!bordered) {
+            tiles.erase(it);
+        }
+    }
+}
+
+void SparseUniverse::advance(uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        step();
+    }
+}
+
+uint64_t SparseUniverse::population() const {
+    uint64_t total = 0;
+    for (const auto& entry : tiles) {
+        for (uint64_t r : entry.second.now().rows) total += popcount(r);
+    }
+    return total;
+}
+
+bool SparseUniverse::bounds(int64_t& min_x, int64_t& min_y, int64_t& max_x, int64_t& max_y) const {
+    bool found = false;
+    min_x = min_y = INT64_MAX;
+    max_x = max_y = INT64_MIN;
+    for (const auto& [key, s] : tiles) {
+        const Tile& t = s.now();
+        uint64_t cols = 0;
+        for (size_t r = 0; r < TILE_SIZE; ++r) {
+            if (!t.rows[r]) continue;
+            cols |= t.rows[r];
+            min_y = std::min(min_y, key.y * TILE_SIZE + int64_t(r));
+            max_y = std::max(max_y, key.y * TILE_SIZE + int64_t(r));
+        }
+        if (!cols) continue;
+        found = true;
+        min_x = std::min(min_x, key.x * TILE_SIZE + count_trailing_zeros(cols));
+        max_x = std::max(max_x, key.x * TILE_SIZE + 63 - count_leading_zeros(cols));
+    }
+    return found;
+}
+
+Grid SparseUniverse::to_grid(int64_t x, int64_t y, size_t w, size_t h) const {
+    Grid g(w, h);
+    g.set_rule(rule);
+    for (const auto& [key, s] : tiles) {
+        const int64_t ox = key.x * TILE_SIZE;
+        const int64_t oy = key.y * TILE_SIZE;
+        if (ox + TILE_SIZE <= x || oy + TILE_SIZE <= y || ox >= x + int64_t(w) || oy >= y + int64_t(h)) {
+            continue;
+        }
+        for (size_t r = 0; r < TILE_SIZE; ++r) {
+            const int64_t gy = oy + int64_t(r) - y;
+            if (gy < 0 || gy >= int64_t(h)) continue;
+            for (uint64_t bits = s.now().rows[r]; bits; bits &= bits - 1) {
+                const int64_t gx = ox + count_trailing_zeros(bits) - x;
+                if (gx >= 0 && gx < int64_t(w)) g.set_cell(gx, gy, LIVE);
+            }
+        }
+    }
+    return g;
+}
@@ -0,0 +1,112 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// binds a thread to one CPU, false when the platform or the CPU set refuses
+bool pin_to_cpu(std::thread& t, size_t cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)t;
+    (void)cpu;
+    return false;
+#endif
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads, bool pin): pinned(pin), task(nullptr), epoch(0), pending(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t id = 1; id < threads; ++id) {
+        workers.emplace_back(&ThreadPool::work, this, id);
+        if (pin) {
+            pinned = pin_to_cpu(workers.back(), id % cpus) && pinned;
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+void ThreadPool::run(const std::function<void(size_t)>& fn) {
+    std::lock_guard<std::mutex> serial(running);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        pending = workers.size();
+        error = nullptr;
+        ++epoch;
+    }
+    wake.notify_all();
+
+    std::exception_ptr own;
+    try {
+        fn(0);
+    }
+    catch (...) {
+        own = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+    task = nullptr;
+    if (own) {
+        std::rethrow_exception(own);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::work(size_t id) {
+    uint64_t seen = 0;
+    for (;;) {
+        const std::function<void(size_t)>* job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || epoch != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = epoch;
+            job = task;
+        }
+
+        std::exception_ptr failure;
+        try {
+            (*job)(id);
+        }
+        catch (...) {
+            failure = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failure && !error) {
+            error = failure;
+        }
+        if (--pending == 0) {
+            done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "cgol.hpp"
+#include "kernels.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// a row of tiles is one band, so quiet rows can share theirs
+static_assert(TileActivity::TILE_ROWS == Grid::BAND_ROWS, "tile rows must match bands");
+
+bool TileActivity::describes(const Grid& g) const {
+    return !changed.empty() && target != 0 && g.get_epoch() == target;
+}
+
+void TileActivity::touch(Grid& g, size_t x, size_t y) {
+    changed[y / TILE_ROWS * columns + x / (TILE_WORDS * Grid::WORD_BITS)] = 1;
+    g.stamp();
+    target = g.get_epoch();
+}
+
+void Grid::step_tiles(Grid& out, WorkStealingScheduler& scheduler, TileActivity& activity) const {
+    if (out.width != width || out.height != height) {
+        throw std::runtime_error("Grid sizes do not match.");
+    }
+    out.rule = rule;
+
+    const size_t words = get_row_words();
+    const size_t columns = (words + TileActivity::TILE_WORDS - 1) / TileActivity::TILE_WORDS;
+    const size_t rows = (height + TileActivity::TILE_ROWS - 1) / TileActivity::TILE_ROWS;
+    const size_t count = columns * rows;
+
+    // the map describes this grid only if it was the last result
+    const bool known = activity.columns == columns && activity.rows == rows &&
+                       activity.changed.size() == count && activity.describes(*this);
+    // out then still holds the previous generation, equal to this one wherever nothing changed
+    const bool in_place = known && activity.source != 0 && activity.source == out.get_epoch();
+    out.unstamp();
+
+    // a tile can only change if something in its neighbourhood did
+    std::vector<uint8_t> active(count, !known);
+    if (known) {
+        for (size_t ty = 0; ty < rows; ++ty) {
+            for (size_t tx = 0; tx < columns; ++tx) {
+                if (!activity.changed[ty * columns + tx]) continue;
+                for (size_t dy = rows - 1; dy <= rows + 1; ++dy) {
+                    for (size_t dx = columns - 1; dx <= columns + 1; ++dx) {
+                        active[(ty + dy) % rows * columns + (tx + dx) % columns] = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    // a row of tiles with nothing to compute is the band of this grid as it is;
+    // the others are written by the tasks, into bands out does not share
+    std::vector<size_t> tasks;
+    for (size_t ty = 0; ty < rows; ++ty) {
+        const auto first = active.begin() + ty * columns;
+        if (std::find(first, first + columns, 1) == first + columns) {
+            out.bands[ty] = bands[ty];
+            continue;
+        }
+        out.band_data(ty);
+        for (size_t tile = ty * columns; tile < (ty + 1) * columns; ++tile) {
+            if (active[tile] || !in_place) {
+                tasks.push_back(tile);
+            }
+        }
+    }
+
+    std::vector<uint8_t> changed(count, 0);
+    const kernels::row_fn kernel = kernels::row_kernel(rule);
+    scheduler.run(tasks.size(), [&](size_t task, size_t) {
+        const size_t tile = tasks[task];
+        const size_t w0 = tile % columns * TileActivity::TILE_WORDS;
+        const size_t w1 = std::min(words, w0 + TileActivity::TILE_WORDS);
+        const size_t y0 = tile / columns * TileActivity::TILE_ROWS;
+        const size_t y1 = std::min(height, y0 + TileActivity::TILE_ROWS);
+
+        if (!active[tile]) {
+            for (size_t y = y0; y < y1; ++y) {
+                std::copy(row(y) + w0, row(y) + w1, out.row(y) + w0);
+            }
+            return;
+        }
+        bool differs = false;
+        for (size_t y = y0; y < y1; ++y) {
+            const word_t* up = row(y == 0 ? height-1 : y-1);
+            const word_t* down = row(y == height-1 ? 0 : y+1);
+            kernel(up, row(y), down, out.row(y), width, w0, w1, rule);
+            differs = differs || !std::equal(row(y) + w0, row(y) + w1, out.row(y) + w0);
+        }
+        changed[tile] = differs;
+    });
+
+    // so is a row of tiles where nothing changed
+    for (size_t ty = 0; ty < rows; ++ty) {
+        const auto first = changed.begin() + ty * columns;
+        if (out.bands[ty] != bands[ty] && std::find(first, first + columns, 1) == first + columns) {
+            out.bands[ty] = bands[ty];
+        }
+    }
+
+    activity.computed = std::count(active.begin(), active.end(), 1);
+    activity.copied = tasks.size() - activity.computed;
+    activity.skipped = count - tasks.size();
+    activity.columns = columns;
+    activity.rows = rows;
+    activity.changed.swap(changed);
+    activity.source = get_epoch();
+    out.stamp();
+    activity.target = out.get_epoch();
+}
@@ -0,0 +1,117 @@
+#include "cgol.hpp"
+#include "kernels.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// generations of one strip that are complete, on a cache line of its own
+struct alignas(64) StripCounter {
+    std::atomic<uint64_t> done{0};
+};
+
+// time one worker spent computing and waiting, on a cache line of its own
+struct alignas(64) WorkerTime {
+    double busy = 0;
+    double wait = 0;
+};
+
+} // namespace
+
+void Grid::advance_wavefront(Grid& out, uint64_t n, ThreadPool* pool, Wavefront& wavefront) const {
+    if (out.width != width || out.height != height) {
+        throw std::runtime_error("Grid sizes do not match.");
+    }
+    wavefront.busy_seconds = 0;
+    wavefront.wait_seconds = 0;
+    out.rule = rule;
+    out.unstamp();
+    if (n == 0 || height == 0) {
+        out.bands = bands;
+        return;
+    }
+
+    const size_t workers = pool != nullptr ? pool->size() : 1;
+    const size_t strips = std::min(workers, height);
+    const size_t words = get_row_words();
+    const kernels::row_fn kernel = kernels::row_kernel(rule);
+
+    // generation t goes to out when odd and to back when even, and is read
+    // from there for t + 1; generation 0 is this grid
+    Grid back(width, height);
+    // strips cross bands, so no worker may have to copy one
+    out.detach();
+    back.detach();
+    auto target = [&](uint64_t t) -> Grid& { return t % 2 ? out : back; };
+    auto source = [&](uint64_t t) -> const Grid& { return t == 0 ? *this : target(t); };
+
+    // Strip k may compute generation t once strips k-1 and k+1 finished t-1:
+    // then the rows it reads are complete, and neither neighbour still reads
+    // the rows of generation t-2 that t overwrites. Neighbours are thus at most
+    // one generation apart, and that is all the synchronisation there is.
+    std::vector<StripCounter> done(strips);
+    std::vector<WorkerTime> times(workers);
+    const bool barrier = wavefront.barrier;
+
+    auto worker = [&](size_t k) {
+        if (k >= strips) {
+            return;
+        }
+        using clock = std::chrono::steady_clock;
+        const size_t up = (k + strips - 1) % strips;
+        const size_t down = (k + 1) % strips;
+        auto ready = [&](uint64_t t) {
+            if (barrier) {
+                for (const StripCounter& c : done) {
+                    if (c.done.load(std::memory_order_acquire) < t) return false;
+                }
+                return true;
+            }
+            return done[up].done.load(std::memory_order_acquire) >= t &&
+                   done[down].done.load(std::memory_order_acquire) >= t;
+        };
+
+        const size_t begin = height * k / strips;
+        const size_t end = height * (k + 1) / strips;
+        for (uint64_t t = 1; t <= n; ++t) {
+            const clock::time_point waiting = clock::now();
+            while (!ready(t - 1)) {
+                std::this_thread::yield();
+            }
+            const clock::time_point start = clock::now();
+
+            const Grid& src = source(t - 1);
+            Grid& dst = target(t);
+            for (size_t y = begin; y < end; ++y) {
+                const word_t* above = src.row(y == 0 ? height-1 : y-1);
+                const word_t* below = src.row(y == height-1 ? 0 : y+1);
+                kernel(above, src.row(y), below, dst.row(y), width, 0, words, rule);
+            }
+            done[k].done.store(t, std::memory_order_release);
+
+            const clock::time_point finish = clock::now();
+            times[k].wait += std::chrono::duration<double>(start - waiting).count();
+            times[k].busy += std::chrono::duration<double>(finish - start).count();
+        }
+    };
+    if (pool != nullptr && workers > 1) {
+        pool->run(worker);
+    }
+    else {
+        worker(0);
+    }
+
+    for (const WorkerTime& t : times) {
+        wavefront.busy_seconds += t.busy;
+        wavefront.wait_seconds += t.wait;
+    }
+    if (n % 2 == 0) {
+        std::swap(out.bands, back.bands);
+    }
+}
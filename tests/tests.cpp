@@ -3,6 +3,24 @@
 
 #include "../include/cgol.hpp"
 #include "../include/parser_utils.hpp"
+#include "../include/kernels.hpp"
+#include "../include/hashlife.hpp"
+#include "../include/sparse.hpp"
+#include "../include/thread_pool.hpp"
+#include "../include/scheduler.hpp"
+#include "../include/triple_buffer.hpp"
+#include "../include/sim_runner.hpp"
+#include "../include/ensemble.hpp"
+#include "../include/domain.hpp"
+#include "../include/mapped.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 bool compare_grid(const Grid& g1, const Grid& g2) {
     if ((g1.get_width() != g2.get_width()) || (g1.get_height() != g2.get_height())){
@@ -87,6 +105,794 @@ TEST_CASE("Test Grid member functions") {
     }
 }
 
+TEST_CASE("Test packed row storage") {
+    Grid grid(130, 3);
+
+    SUBCASE("rows are padded to whole cache lines") {
+        CHECK(grid.get_row_words() == 3);
+        CHECK(grid.get_stride() == 8);
+        CHECK(grid.row(1) - grid.row(0) == 8);
+        CHECK(reinterpret_cast<uintptr_t>(grid.row(0)) % 64 == 0);
+    }
+
+    SUBCASE("cells map onto row words") {
+        grid.set_cell(0, 1, LIVE);
+        grid.set_cell(65, 1, LIVE);
+        grid.set_cell(129, 2, LIVE);
+        CHECK(grid.row(1)[0] == 1);
+        CHECK(grid.row(1)[1] == 2);
+        CHECK(grid.row(2)[2] == 2);
+        CHECK(grid.last_word_mask() == 3);
+
+        grid.set_cell(65, 1, DEAD);
+        CHECK(grid.row(1)[1] == 0);
+    }
+
+    SUBCASE("random() leaves bits past the width clear") {
+        grid.random();
+        for (size_t y = 0; y < grid.get_height(); ++y) {
+            CHECK((grid.row(y)[2] & ~grid.last_word_mask()) == 0);
+        }
+    }
+}
+
+TEST_CASE("Test copy-on-write bands") {
+    std::vector<std::vector<bool>> cells = {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}};
+    Grid grid(100, 300);
+    grid.place(Grid(3, 3, cells), 10, 70);
+    grid.detach();
+    REQUIRE(grid.get_bands() == 5);
+
+    SUBCASE("copies share every band until one is written") {
+        const uint64_t allocations = grid_allocations;
+        Grid copy = grid;
+        CHECK(grid_allocations == allocations);
+        CHECK(copy.count_shared_bands() == 5);
+
+        copy.set_cell(50, 200, LIVE);
+        CHECK(grid_allocations == allocations + 1);
+        CHECK(!copy.shares_band(grid, 3));
+        CHECK(copy.shares_band(grid, 0));
+        CHECK(!grid.get_cell(50, 200));
+        CHECK(copy != grid);
+        copy.set_cell(50, 200, DEAD);
+        CHECK(copy == grid);
+    }
+
+    SUBCASE("a step allocates only the bands that changed") {
+        ThreadPool threads(2);
+        for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &threads}) {
+            // into a result owning its bands: all are computed in place and kept,
+            // so a band that livens up later still has its storage
+            Grid next(100, 300);
+            next.detach();
+            uint64_t allocations = grid_allocations;
+            grid.step_into(next, Engine::Bitsliced, pool);
+            CHECK(grid_allocations == allocations);
+            CHECK(next == grid.get_next_state(Engine::Naive));
+            CHECK(next.count_shared_bands() == 0);
+            // into a result sharing all its bands: the quiet ones are shared with
+            // the source, and only the changed one needs storage
+            Grid after = grid;
+            allocations = grid_allocations;
+            next.step_into(after, Engine::Bitsliced, pool);
+            CHECK(grid_allocations == allocations + 1);
+            CHECK(after.count_shared_bands() == 4);
+            for (size_t b = 0; b < grid.get_bands(); ++b) {
+                CHECK(after.shares_band(next, b) == (b != 1));
+            }
+            CHECK(after == next.get_next_state(Engine::Naive));
+        }
+    }
+
+    SUBCASE("Simulation snapshots and history share unchanged bands") {
+        Simulation s(grid);
+        s.set_threads(2, false, Schedule::WorkStealing);
+        s.step();
+        s.step();
+        Grid snapshot = s.cur();
+        CHECK(snapshot.count_shared_bands() == 5);
+        s.step();
+        CHECK(s.current().shares_band(snapshot, 0));
+        CHECK(!s.current().shares_band(snapshot, 1));
+        // the history deltas of quiet bands are next to nothing, next to the
+        // bookkeeping of each entry
+        const HistoryStats stats = s.get_history_stats();
+        CHECK(stats.bytes < 200 + 64 * stats.entries);
+        s.prev();
+        CHECK(s.current() == snapshot);
+        s.reset();
+        CHECK(s.current() == grid);
+    }
+}
+
+TEST_CASE("Test grid views") {
+    Grid grid(300, 150);
+    grid.random();
+
+    SUBCASE("a view of a grid reads its rows in place") {
+        const uint64_t allocations = grid_allocations;
+        const GridView view = grid;
+        const Grid& cgrid = grid;
+        CHECK(view.row(100) == cgrid.row(100));
+        CHECK(view.get_cell(299, 149) == grid.get_cell(299, 149));
+        const Grid copy(view);
+        CHECK(copy.count_shared_bands() == copy.get_bands());
+        CHECK(copy == grid);
+        CHECK(grid_allocations == allocations);
+    }
+
+    SUBCASE("windows off word boundaries") {
+        const GridView window = GridView(grid).window(70, 65, 130, 20);
+        const Grid copy(window);
+        size_t live = 0;
+        for (size_t y = 0; y < 20; ++y) {
+            std::vector<size_t> xs;
+            window.for_each_live(y, [&](size_t x) { xs.push_back(x); });
+            std::vector<size_t> expected;
+            for (size_t x = 0; x < 130; ++x) {
+                CHECK(window.get_cell(x, y) == grid.get_cell(70 + x, 65 + y));
+                CHECK(copy.get_cell(x, y) == grid.get_cell(70 + x, 65 + y));
+                if (grid.get_cell(70 + x, 65 + y)) expected.push_back(x);
+            }
+            CHECK(xs == expected);
+            live += xs.size();
+
+            // runs cover the same cells, each ended by a dead cell or the window
+            std::vector<size_t> covered;
+            size_t last_end = 0;
+            window.for_each_run(y, [&](size_t begin, size_t end) {
+                CHECK(begin < end);
+                CHECK((begin == 0 || begin > last_end));
+                CHECK((end == 130 || !window.get_cell(end, y)));
+                for (size_t x = begin; x < end; ++x) covered.push_back(x);
+                last_end = end;
+            });
+            CHECK(covered == expected);
+        }
+        CHECK(window.population() == live);
+
+        // runs across whole words and ending on the window's edge
+        Grid wide(300, 1);
+        for (size_t x = 10; x < 200; ++x) wide.set_cell(x, 0, LIVE);
+        for (size_t x = 250; x < 300; ++x) wide.set_cell(x, 0, LIVE);
+        std::vector<std::pair<size_t, size_t>> runs;
+        GridView(wide).window(5, 0, 251, 1).for_each_run(0, [&](size_t b, size_t e) { runs.emplace_back(b, e); });
+        CHECK(runs == std::vector<std::pair<size_t, size_t>>{{5, 195}, {245, 251}});
+        CHECK_THROWS(window.window(100, 0, 31, 1));
+    }
+
+    SUBCASE("the minimal window and saving it") {
+        std::vector<std::vector<bool>> cells = {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}};
+        Grid board(200, 100);
+        board.place(Grid(3, 3, cells), 130, 70);
+        const GridView minimal = GridView(board).minimal();
+        CHECK(minimal.get_width() == 3);
+        CHECK(minimal.get_height() == 3);
+        CHECK(Grid(minimal) == Grid(3, 3, cells));
+        CHECK(board.get_minimal() == Grid(3, 3, cells));
+        CHECK(GridView(Grid(5, 5)).minimal().get_width() == 0);
+
+        FileHandler f;
+        f.save(minimal, "test.rle");
+        CHECK(f.read("test.rle") == Grid(3, 3, cells));
+        std::remove("test.rle");
+    }
+
+    SUBCASE("Simulation hands out the current generation without copying") {
+        Simulation s(grid);
+        s.step();
+        const uint64_t allocations = grid_allocations;
+        const GridView view = s.view();
+        CHECK(view.population() == GridView(s.current()).population());
+        CHECK(SparseUniverse(view).population() == view.population());
+        CHECK(grid_allocations == allocations);
+    }
+}
+
+TEST_CASE("Test buffer pool") {
+    SUBCASE("freed buffers serve the next request of their class") {
+        buffer_pool::trim();
+        const BufferPoolStats before = buffer_pool::stats();
+        void* a = buffer_pool::allocate(1000, 64);
+        CHECK(reinterpret_cast<uintptr_t>(a) % 64 == 0);
+        buffer_pool::deallocate(a, 1000, 64);
+        // 1000 and 1010 bytes share the 1024 class
+        void* b = buffer_pool::allocate(1010, 64);
+        CHECK(b == a);
+        const BufferPoolStats after = buffer_pool::stats();
+        CHECK(after.misses == before.misses + 1);
+        CHECK(after.hits == before.hits + 1);
+        CHECK(after.returned == before.returned + 1);
+        buffer_pool::deallocate(b, 1010, 64);
+        CHECK(buffer_pool::stats().pooled_bytes == before.pooled_bytes + 1024);
+    }
+
+    SUBCASE("large buffers are aligned to huge pages") {
+        void* p = buffer_pool::allocate(buffer_pool::HUGE_PAGE + 1, 64);
+        CHECK(reinterpret_cast<uintptr_t>(p) % buffer_pool::HUGE_PAGE == 0);
+        buffer_pool::deallocate(p, buffer_pool::HUGE_PAGE + 1, 64);
+    }
+
+    SUBCASE("nothing is pooled past the limit") {
+        const size_t limit = buffer_pool::get_limit();
+        buffer_pool::set_limit(0);
+        CHECK(buffer_pool::stats().pooled_bytes == 0);
+        const BufferPoolStats before = buffer_pool::stats();
+        buffer_pool::deallocate(buffer_pool::allocate(4096, 64), 4096, 64);
+        CHECK(buffer_pool::stats().released == before.released + 1);
+        buffer_pool::set_limit(limit);
+    }
+
+    SUBCASE("temporary grids recycle each other's bands") {
+        Grid grid(200, 200);
+        grid.random();
+        grid = grid.get_next_state();
+        buffer_pool::reset_stats();
+        for (int gen = 0; gen < 10; ++gen) {
+            grid = grid.get_next_state();
+        }
+        const BufferPoolStats stats = buffer_pool::stats();
+        CHECK(stats.hits > 0);
+        CHECK(stats.misses == 0);
+    }
+}
+
+TEST_CASE("Test bitsliced engine") {
+
+    SUBCASE("matches the naive engine on random grids") {
+        const size_t sizes[][2] = {{1, 1}, {1, 5}, {5, 1}, {2, 2}, {3, 7}, {63, 9}, {64, 4}, {65, 3}, {130, 17}, {200, 200}};
+        for (const auto& size : sizes) {
+            Grid grid(size[0], size[1]);
+            grid.random();
+            for (int gen = 0; gen < 8; ++gen) {
+                Grid naive = grid.get_next_state(Engine::Naive);
+                Grid bitsliced = grid.get_next_state(Engine::Bitsliced);
+                CHECK(compare_grid(naive, bitsliced));
+                CHECK(naive == bitsliced);
+                grid = bitsliced;
+            }
+        }
+    }
+
+    SUBCASE("every supported kernel matches the naive engine") {
+        const kernels::Isa startup = kernels::active_isa();
+        CHECK(kernels::isa_supported(kernels::Isa::Scalar));
+        CHECK(kernels::isa_supported(startup));
+
+        for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2, kernels::Isa::AVX512}) {
+            if (!kernels::isa_supported(isa)) {
+                CHECK_THROWS(kernels::set_isa(isa));
+                continue;
+            }
+            kernels::set_isa(isa);
+            CHECK(kernels::active_isa() == isa);
+            for (size_t width : {1, 64, 65, 127, 300, 1000, 1025}) {
+                Grid grid(width, 9);
+                grid.random();
+                CHECK(grid.get_next_state(Engine::Naive) == grid.get_next_state(Engine::Bitsliced));
+            }
+        }
+        kernels::set_isa(startup);
+    }
+
+    SUBCASE("glider wraps around the torus") {
+        std::vector<std::vector<bool>> cells = {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}};
+        Grid grid(70, 6);
+        grid.place(Grid(3, 3, cells), 67, 3);
+        Simulation naive(grid);
+        Simulation bitsliced(grid);
+        naive.set_engine(Engine::Naive);
+        CHECK(bitsliced.get_engine() == Engine::Bitsliced);
+        for (int gen = 0; gen < 40; ++gen) {
+            CHECK(naive.next() == bitsliced.next());
+        }
+    }
+}
+
+TEST_CASE("Test rules") {
+
+    SUBCASE("parse() accepts B/S and survival/birth notation") {
+        CHECK(Rule::parse("B3/S23") == rules::CONWAY);
+        CHECK(Rule::parse("b3/s23") == rules::CONWAY);
+        CHECK(Rule::parse(" S23/B3 ") == rules::CONWAY);
+        CHECK(Rule::parse("23/3") == rules::CONWAY);
+        CHECK(Rule::parse("23/36") == rules::HIGHLIFE);
+        CHECK(Rule::parse("B3678/S34678") == rules::DAY_AND_NIGHT);
+        CHECK(Rule::parse("B2/S") == rules::SEEDS);
+        CHECK(rules::HIGHLIFE.to_string() == "B36/S23");
+        CHECK(rules::SEEDS.to_string() == "B2/S");
+        CHECK_THROWS(Rule::parse("B3S23"));
+        CHECK_THROWS(Rule::parse("B9/S23"));
+        CHECK_THROWS(Rule::parse("B3/S23/2"));
+    }
+
+    SUBCASE("every kernel matches the naive engine under each rule") {
+        const Rule tested[] = {rules::CONWAY, rules::HIGHLIFE, rules::DAY_AND_NIGHT, rules::SEEDS,
+                               Rule::parse("B36/S125"), Rule::parse("B0/S8"), Rule::parse("B012345678/S")};
+        const kernels::Isa startup = kernels::active_isa();
+        for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2, kernels::Isa::AVX512}) {
+            if (!kernels::isa_supported(isa)) continue;
+            kernels::set_isa(isa);
+            for (const Rule& rule : tested) {
+                for (size_t width : {5, 64, 130, 700}) {
+                    Grid grid(width, 11);
+                    grid.random();
+                    grid.set_rule(rule);
+                    for (int gen = 0; gen < 4; ++gen) {
+                        Grid bitsliced = grid.get_next_state(Engine::Bitsliced);
+                        CHECK(bitsliced == grid.get_next_state(Engine::Naive));
+                        CHECK(bitsliced.get_rule() == rule);
+                        grid = bitsliced;
+                    }
+                }
+            }
+        }
+        kernels::set_isa(startup);
+    }
+
+    SUBCASE("Simulation::advance() carries the rule through every mode") {
+        Grid grid(96, 80);
+        grid.random();
+        grid.set_rule(rules::HIGHLIFE);
+        Grid expected = grid;
+        for (int gen = 0; gen < 37; ++gen) {
+            expected = expected.get_next_state(Engine::Naive);
+        }
+        for (AdvanceMode mode : {AdvanceMode::Step, AdvanceMode::HashLife, AdvanceMode::TemporalBlocking}) {
+            Simulation s(grid);
+            s.set_advance_mode(mode);
+            CHECK(s.advance(37) == expected);
+            CHECK(s.get_rule() == rules::HIGHLIFE);
+        }
+
+        // HashLife keeps its memoized results between jumps, until the rule changes
+        Simulation jumps(grid);
+        jumps.set_advance_mode(AdvanceMode::HashLife);
+        CHECK(jumps.advance(37) == expected);
+        CHECK(jumps.advance(37) == Simulation(expected).advance(37));
+        jumps.set_rule(rules::CONWAY);
+        Grid conway = jumps.current();
+        for (int gen = 0; gen < 20; ++gen) {
+            conway = conway.get_next_state(Engine::Naive);
+        }
+        CHECK(jumps.advance(20) == conway);
+
+        // B0 rules cannot run on HashLife and fall back to stepping
+        grid.set_rule(Rule::parse("B0/S8"));
+        Simulation s(grid);
+        s.set_advance_mode(AdvanceMode::HashLife);
+        CHECK(s.advance(5) == grid.get_next_state().get_next_state().get_next_state().get_next_state().get_next_state());
+        CHECK_THROWS(HashLife(grid));
+        CHECK_THROWS(SparseUniverse(grid));
+    }
+
+    SUBCASE("set_rule() drops the future") {
+        Simulation s(Grid(10, 10));
+        s.next();
+        s.next();
+        s.prev();
+        s.set_rule(rules::SEEDS);
+        CHECK(s.get_rule() == rules::SEEDS);
+        s.next();
+        CHECK(s.cur().get_rule() == rules::SEEDS);
+    }
+
+    SUBCASE("sparse universe matches HashLife under every rule kernel") {
+        for (const Rule& rule : {rules::HIGHLIFE, rules::DAY_AND_NIGHT, rules::SEEDS, Rule::parse("B36/S125")}) {
+            Grid soup(120, 120);
+            soup.random();
+            soup.set_rule(rule);
+            SparseUniverse u(soup, -60, -60);
+            HashLife ref(soup, -60, -60);
+            for (int round = 0; round < 4; ++round) {
+                u.advance(40);
+                ref.advance(40);
+                CHECK(u.population() == ref.population());
+                CHECK(u.to_grid(-200, -200, 400, 400) == ref.to_grid(-200, -200, 400, 400));
+            }
+        }
+    }
+}
+
+TEST_CASE("Test HashLife engine") {
+    FileHandler f;
+
+    SUBCASE("set_cell() and get_cell() on the unbounded plane") {
+        HashLife life;
+        life.set_cell(-1000000, 5, LIVE);
+        life.set_cell(123456789, -42, LIVE);
+        CHECK(life.get_cell(-1000000, 5) == LIVE);
+        CHECK(life.get_cell(123456789, -42) == LIVE);
+        CHECK(life.get_cell(0, 0) == DEAD);
+        CHECK(life.population() == 2);
+    }
+
+    SUBCASE("matches get_next_state() while the pattern does not wrap") {
+        Grid gun = f.read("data/gosper_glider_gun.rle");
+        Grid board(128, 128);
+        board.place(gun, 10, 10);
+
+        HashLife life(board);
+        Grid expected = board;
+        for (int gen = 0; gen < 100; ++gen) {
+            expected = expected.get_next_state();
+        }
+        life.advance(100);
+        CHECK(life.get_generation() == 100);
+        CHECK(life.to_grid(0, 0, 128, 128) == expected);
+
+        life.collect_garbage();
+        life.set_step(3);
+        life.next();
+        for (int gen = 0; gen < 8; ++gen) {
+            expected = expected.get_next_state();
+        }
+        CHECK(life.to_grid(0, 0, 128, 128) == expected);
+    }
+
+    SUBCASE("the glider gun reaches generation 10^9") {
+        HashLife life(f.read("data/gosper_glider_gun.rle"));
+        life.advance(1000000000);
+        CHECK(life.get_generation() == 1000000000);
+        // the gun is periodic with period 30 and emits one 5-cell glider per period
+        HashLife ref(f.read("data/gosper_glider_gun.rle"));
+        ref.advance(1000000000 % 30);
+        CHECK(life.population() == ref.population() + 5 * (1000000000 / 30));
+    }
+
+    SUBCASE("advance_torus() matches get_next_state() on the torus") {
+        const size_t sizes[][2] = {{1, 1}, {3, 5}, {13, 7}, {20, 20}, {64, 3}, {70, 33}};
+        for (const auto& size : sizes) {
+            Grid grid(size[0], size[1]);
+            grid.random();
+            Grid expected = grid;
+            for (int gen = 0; gen < 77; ++gen) {
+                expected = expected.get_next_state();
+            }
+            HashLife life;
+            CHECK(life.advance_torus(grid, 77) == expected);
+        }
+    }
+
+    SUBCASE("Simulation::advance() with either mode") {
+        Grid grid(40, 30);
+        grid.random();
+        Simulation stepped(grid);
+        Simulation jumped(grid);
+        jumped.set_advance_mode(AdvanceMode::HashLife);
+
+        CHECK(stepped.advance(300) == jumped.advance(300));
+        CHECK(jumped.get_tick() == 1);
+        CHECK(jumped.get_generation() == 300);
+        jumped.next();
+        CHECK(jumped.get_generation() == 301);
+        jumped.prev();
+        jumped.prev();
+        CHECK(jumped.get_generation() == 0);
+        CHECK(jumped.cur() == grid);
+    }
+}
+
+TEST_CASE("Test sparse universe") {
+    FileHandler f;
+    std::vector<std::vector<bool>> cells = {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}};
+    Grid glider(3, 3, cells);
+
+    SUBCASE("cells at far apart 64-bit coordinates") {
+        SparseUniverse u;
+        u.set_cell(-5000000000LL, 7, LIVE);
+        u.set_cell(5000000000LL, -7, LIVE);
+        CHECK(u.get_cell(-5000000000LL, 7) == LIVE);
+        CHECK(u.get_cell(5000000000LL, -7) == LIVE);
+        CHECK(u.tile_count() == 2);
+        u.set_cell(5000000000LL, -7, DEAD);
+        CHECK(u.population() == 1);
+        // lone cells die and their tiles are dropped once they stay empty
+        u.advance(3);
+        CHECK(u.population() == 0);
+        CHECK(u.tile_count() == 0);
+    }
+
+    SUBCASE("matches HashLife on the glider gun") {
+        Grid gun = f.read("data/gosper_glider_gun.rle");
+        SparseUniverse u(gun, -20, -70);
+        HashLife ref(gun, -20, -70);
+        u.advance(500);
+        ref.advance(500);
+        CHECK(u.get_generation() == 500);
+        CHECK(u.population() == ref.population());
+
+        int64_t min_x, min_y, max_x, max_y;
+        REQUIRE(u.bounds(min_x, min_y, max_x, max_y));
+        const size_t w = max_x - min_x + 1;
+        const size_t h = max_y - min_y + 1;
+        CHECK(u.to_grid(min_x, min_y, w, h) == ref.to_grid(min_x, min_y, w, h));
+    }
+
+    SUBCASE("skipping stable tiles matches HashLife on a soup") {
+        Grid soup(150, 150);
+        soup.random();
+        SparseUniverse u(soup, -75, -75);
+        HashLife ref(soup, -75, -75);
+        for (int round = 0; round < 6; ++round) {
+            u.advance(50);
+            ref.advance(50);
+            // edits invalidate the remembered history of a tile
+            u.set_cell(round, -round, LIVE);
+            ref.set_cell(round, -round, LIVE);
+            u.set_cell(-100, 7 * round, LIVE);
+            ref.set_cell(-100, 7 * round, LIVE);
+            CHECK(u.population() == ref.population());
+            CHECK(u.to_grid(-250, -250, 500, 500) == ref.to_grid(-250, -250, 500, 500));
+        }
+    }
+
+    SUBCASE("still lifes are skipped and blinkers flipped") {
+        SparseUniverse u;
+        // block
+        u.set_cell(10, 10, LIVE);
+        u.set_cell(11, 10, LIVE);
+        u.set_cell(10, 11, LIVE);
+        u.set_cell(11, 11, LIVE);
+        // blinker, far away
+        u.set_cell(1000, 1000, LIVE);
+        u.set_cell(1001, 1000, LIVE);
+        u.set_cell(1002, 1000, LIVE);
+        u.advance(4);
+        CHECK(u.last_step().computed == 0);
+        CHECK(u.last_step().flipped == 1);
+        CHECK(u.last_step().skipped == u.tile_count() - 1);
+        u.advance(1);
+        CHECK(u.get_cell(1001, 999) == LIVE);
+        CHECK(u.get_cell(1001, 1001) == LIVE);
+        CHECK(u.get_cell(1000, 1000) == DEAD);
+        CHECK(u.population() == 7);
+    }
+
+    SUBCASE("memory follows the live area") {
+        SparseUniverse u(glider);
+        u.advance(4 * 1000);
+        int64_t min_x, min_y, max_x, max_y;
+        REQUIRE(u.bounds(min_x, min_y, max_x, max_y));
+        CHECK(min_x == 1000);
+        CHECK(min_y == 1000);
+        CHECK(u.population() == 5);
+        CHECK(u.tile_count() <= 4);
+    }
+}
+
+TEST_CASE("Test ensemble") {
+
+    SUBCASE("every universe matches its own grid under every kernel") {
+        const size_t sizes[][2] = {{1, 1}, {5, 7}, {16, 16}, {32, 32}, {33, 9}};
+        const kernels::Isa startup = kernels::active_isa();
+        for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2, kernels::Isa::AVX512}) {
+            if (!kernels::isa_supported(isa)) continue;
+            kernels::set_isa(isa);
+            for (const auto& size : sizes) {
+                for (const Rule& rule : {rules::CONWAY, Rule::parse("B36/S125")}) {
+                    Ensemble e(130, size[0], size[1], rule);
+                    e.random();
+                    std::vector<Grid> grids;
+                    for (size_t u = 0; u < e.size(); ++u) {
+                        grids.push_back(e.get(u));
+                    }
+                    e.advance(6);
+                    const std::vector<uint64_t> populations = e.populations();
+                    for (size_t u = 0; u < e.size(); ++u) {
+                        for (int gen = 0; gen < 6; ++gen) {
+                            grids[u] = grids[u].get_next_state(Engine::Naive);
+                        }
+                        CHECK(e.get(u) == grids[u]);
+                        CHECK(e.get_generation(u) == 6);
+                        CHECK(e.population(u) == populations[u]);
+                    }
+                }
+            }
+        }
+        kernels::set_isa(startup);
+    }
+
+    SUBCASE("universes keep their own generation and population") {
+        std::vector<std::vector<bool>> cells = {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}};
+        Grid glider(16, 16);
+        glider.place(Grid(3, 3, cells), 2, 2);
+        Grid blinker(16, 16);
+        blinker.set_cell(5, 5, LIVE);
+        blinker.set_cell(6, 5, LIVE);
+        blinker.set_cell(7, 5, LIVE);
+
+        Ensemble e(100, 16, 16);
+        CHECK(e.population(99) == 0);
+        e.set(3, glider);
+        e.set(70, blinker);
+        e.set(71, glider);
+        e.set_frozen(71, true);
+        e.advance(4);
+        e.set(99, blinker);
+        e.step();
+
+        CHECK(e.get(3) == glider.get_next_state().get_next_state().get_next_state().get_next_state().get_next_state());
+        CHECK(e.get_generation(3) == 5);
+        CHECK(e.get(70) == blinker.get_next_state());
+        CHECK(e.get(99) == blinker.get_next_state());
+        CHECK(e.get_generation(99) == 1);
+        CHECK(e.get(71) == glider);
+        CHECK(e.get_generation(71) == 0);
+        CHECK(e.is_frozen(71));
+        const std::vector<uint64_t> populations = e.populations();
+        CHECK(populations[3] == 5);
+        CHECK(populations[70] == 3);
+        CHECK(populations[0] == 0);
+        CHECK(populations[71] == 5);
+
+        // the lanes past the last universe are not universes
+        CHECK_THROWS(e.set_frozen(100, false));
+        CHECK_THROWS(e.get(127));
+        CHECK_THROWS(e.set(100, blinker));
+        e.step();
+        CHECK(e.get(99) == blinker);
+        CHECK(e.populations()[99] == 3);
+    }
+}
+
+TEST_CASE("Test domain decomposition") {
+
+    SUBCASE("slabs on separate processes match stepping for any rank count") {
+        const size_t sizes[][2] = {{64, 64}, {100, 37}, {9, 4}};
+        for (const auto& size : sizes) {
+            for (const Rule& rule : {rules::CONWAY, rules::HIGHLIFE}) {
+                Grid g(size[0], size[1]);
+                g.set_rule(rule);
+                g.random();
+                Grid expected = g;
+                for (int gen = 0; gen < 10; ++gen) {
+                    expected = expected.get_next_state();
+                }
+                for (size_t processes : {1, 2, 3, 4}) {
+                    const Grid result = advance_processes(g, 10, processes);
+                    CHECK(result == expected);
+                    CHECK(result.get_rule() == rule);
+                }
+            }
+        }
+    }
+
+    SUBCASE("a rank per row and too many ranks") {
+        Grid g(32, 5);
+        g.random();
+        CHECK(advance_processes(g, 3, 5) == g.get_next_state().get_next_state().get_next_state());
+        CHECK_THROWS(advance_processes(g, 3, 6));
+    }
+
+    SUBCASE("ranks fork from a threaded process and leave other children alone") {
+        Grid g(200, 130);
+        g.random();
+        Simulation s(g);
+        s.set_threads(4);
+        s.set_advance_mode(AdvanceMode::Processes);
+        s.set_processes(3);
+
+        // another thread keeps taking the buffer pool's lock while ranks fork
+        std::atomic<bool> stop{false};
+        std::thread churn([&] {
+            while (!stop) {
+                Grid scratch(300, 300);
+                scratch.detach();
+            }
+        });
+        // an unrelated child of this process, exiting while the ranks run
+        const pid_t other = fork();
+        if (other == 0) {
+            usleep(1000);
+            _exit(7);
+        }
+        Grid expected = g;
+        for (int round = 0; round < 5; ++round) {
+            s.advance(4);
+            s.step();
+            for (int gen = 0; gen < 5; ++gen) {
+                expected = expected.get_next_state();
+            }
+            CHECK(s.current() == expected);
+        }
+        stop = true;
+        churn.join();
+
+        int status = 0;
+        REQUIRE(waitpid(other, &status, 0) == other);
+        CHECK(WIFEXITED(status));
+        CHECK(WEXITSTATUS(status) == 7);
+    }
+
+    SUBCASE("Simulation::advance() gathers a board FileHandler can save") {
+        FileHandler f;
+        Simulation s(f.read("data/gosper_glider_gun.rle"));
+        Simulation reference = s;
+        s.set_advance_mode(AdvanceMode::Processes);
+        s.set_processes(3);
+        s.advance(30);
+        reference.advance(30);
+        CHECK(s.get_generation() == 30);
+        CHECK(compare_grid(s.cur(), reference.cur()));
+
+        f.save(s.cur(), "test.rle");
+        CHECK(compare_grid(f.read("test.rle"), reference.cur()));
+        std::remove("test.rle");
+    }
+}
+
+TEST_CASE("Test memory-mapped boards") {
+    const std::string path = "test.board";
+    std::remove(path.c_str());
+    Grid g(150, 70);
+    g.set_rule(rules::HIGHLIFE);
+    g.random();
+    MappedGrid::create(path, g);
+    Grid expected = g;
+    for (int gen = 0; gen < 5; ++gen) {
+        expected = expected.get_next_state();
+    }
+    const uint64_t row_bytes = g.get_stride() * sizeof(Grid::word_t);
+
+    SUBCASE("advancing matches stepping in memory") {
+        MappedGrid m(path);
+        CHECK(m.get_rule() == rules::HIGHLIFE);
+        CHECK(m.read_rows(0, 70) == g);
+        m.set_checkpoint_rows(16);
+        CHECK(m.advance(5) == 5);
+        CHECK(m.get_generation() == 5);
+        CHECK(m.read_rows(0, 70) == expected);
+        CHECK(Grid(m.view()) == expected);
+        CHECK(m.get_cell(3, 4) == expected.get_cell(3, 4));
+
+        // every row read once, row 0 twice for the wrap, and written once
+        const MappedStats& stats = m.get_stats();
+        CHECK(stats.bytes_read == 5 * 71 * row_bytes);
+        CHECK(stats.bytes_written == 5 * 70 * row_bytes);
+        CHECK(stats.checkpoints == 5 * 5);
+        CHECK(stats.rows == 5 * 70);
+    }
+
+    SUBCASE("a stopped run resumes where it left off") {
+        std::atomic<bool> stop{false};
+        {
+            MappedGrid m(path);
+            m.set_checkpoint_rows(16);
+            CHECK(m.advance(2) == 2);
+            stop = true;
+            CHECK(m.advance(3, &stop) == 0);
+            CHECK(m.get_rows_done() == 16);
+        }
+        MappedGrid m(path);
+        CHECK(m.get_generation() == 2);
+        CHECK(m.get_rows_done() == 16);
+        CHECK(m.advance(3) == 3);
+        CHECK(m.get_stats().rows == 3 * 70 - 16);
+        CHECK(m.read_rows(0, 70) == expected);
+    }
+
+    SUBCASE("edits drop a half-done generation") {
+        std::atomic<bool> stop{true};
+        MappedGrid m(path);
+        m.set_checkpoint_rows(16);
+        m.advance(1, &stop);
+        m.set_cell(0, 0, !g.get_cell(0, 0));
+        g.set_cell(0, 0, !g.get_cell(0, 0));
+        CHECK(m.get_rows_done() == 0);
+        m.advance(1);
+        CHECK(m.read_rows(0, 70) == g.get_next_state());
+    }
+
+    SUBCASE("files are not overwritten or misread") {
+        CHECK_THROWS(MappedGrid::create(path, 10, 10));
+        CHECK_THROWS(MappedGrid("data/glider.rle"));
+        CHECK_THROWS(MappedGrid("no such board"));
+    }
+    std::remove(path.c_str());
+}
+
 TEST_CASE("Initialize simulation correctly") {
     
     SUBCASE("Default initialization") {
@@ -159,6 +965,672 @@ TEST_CASE("Test Simulation member functions") {
         CHECK(resetGrid.get_cell(1, 2) == LIVE);
         CHECK(resetGrid.get_cell(1, 3) == LIVE);
     }
+
+    SUBCASE("test precompute() and get_precomputed() functions") {
+        Grid grid(40, 30);
+        grid.random();
+        Simulation s(grid);
+        Simulation reference(grid);
+        CHECK(s.precompute());
+        CHECK(s.precompute());
+        CHECK(s.precompute());
+        CHECK(s.get_tick() == 0);
+        CHECK(s.get_precomputed() == 3);
+
+        const uint64_t steps = s.get_steps();
+        s.step();
+        s.step();
+        reference.step();
+        reference.step();
+        CHECK(s.get_steps() == steps);
+        CHECK(s.current() == reference.current());
+        CHECK(s.get_precomputed() == 1);
+
+        s.set_cell(3, 3, !s.get_cell(3, 3));
+        reference.set_cell(3, 3, !reference.get_cell(3, 3));
+        CHECK(s.get_precomputed() == 0);
+        s.step();
+        reference.step();
+        CHECK(s.current() == reference.current());
+        CHECK(s.get_steps() == steps + 1);
+
+        s.advance(10);
+        s.prev();
+        CHECK(s.get_precomputed() == 0);
+        CHECK(!s.precompute());
+        s.set_history(false);
+        CHECK(!s.precompute());
+    }
+}
+
+TEST_CASE("Test double-buffered stepping") {
+    Grid grid(100, 80);
+    grid.random();
+    Simulation buffered(grid);
+    Simulation reference(grid);
+
+    buffered.next();
+    reference.next();
+    buffered.set_history(false);
+    CHECK(buffered.get_tick() == 0);
+    CHECK(buffered.get_generation() == 1);
+
+    const uint64_t allocations = buffered.get_step_allocations();
+    for (int gen = 0; gen < 50; ++gen) {
+        buffered.step();
+        reference.step();
+        CHECK(buffered.current() == reference.current());
+    }
+    buffered.set_advance_mode(AdvanceMode::Step);
+    buffered.advance(25);
+    reference.advance(25);
+    CHECK(buffered.current() == reference.current());
+    CHECK(buffered.get_generation() == 76);
+
+    // the steady-state loop does not allocate at all
+    CHECK(buffered.get_step_allocations() == allocations);
+    CHECK(buffered.get_steps() == 76);
+    CHECK(reference.get_step_allocations() > 0);
+
+    buffered.set_history(true);
+    buffered.next();
+    buffered.prev();
+    CHECK(buffered.current() == reference.current());
+
+    // still lifes and oscillators cost nothing
+    Grid quiet(256, 256);
+    quiet.place(Grid(2, 2, {{LIVE, LIVE}, {LIVE, LIVE}}), 20, 20);
+    quiet.place(Grid(3, 1, {{LIVE, LIVE, LIVE}}), 150, 200);
+    for (size_t threads : {1, 2}) {
+        Simulation still(quiet);
+        still.set_threads(threads);
+        still.set_history(false);
+        const uint64_t before = still.get_step_allocations();
+        for (int gen = 0; gen < 100; ++gen) {
+            still.step();
+        }
+        CHECK(still.get_step_allocations() == before);
+        CHECK(still.current() == quiet);
+        CHECK(still.current().count_shared_bands() == 0);
+    }
+
+    // nor does a glider moving into bands that were quiet until then
+    Grid crossing(128, 512);
+    crossing.place(Grid(3, 3, {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}}), 10, 56);
+    Grid expected = crossing;
+    for (int gen = 0; gen < 1000; ++gen) {
+        expected = expected.get_next_state();
+    }
+    for (size_t threads : {1, 2}) {
+        Simulation glider(crossing);
+        glider.set_threads(threads);
+        glider.set_history(false);
+        const uint64_t allocations = grid_allocations;
+        for (int gen = 0; gen < 1000; ++gen) {
+            glider.step();
+        }
+        CHECK(grid_allocations == allocations);
+        CHECK(glider.current() == expected);
+    }
+}
+
+TEST_CASE("Test temporal blocking") {
+
+    SUBCASE("matches n calls of get_next_state()") {
+        const size_t sizes[][2] = {{1, 1}, {5, 3}, {70, 9}, {130, 100}, {200, 37}};
+        const size_t tiles[][2] = {{0, 8}, {1, 1}, {4, 3}, {16, 5}, {7, 20}};
+        for (const auto& size : sizes) {
+            Grid grid(size[0], size[1]);
+            grid.random();
+            Grid expected = grid;
+            for (int gen = 0; gen < 23; ++gen) {
+                expected = expected.get_next_state();
+            }
+            for (const auto& tile : tiles) {
+                TemporalBlocking blocking;
+                blocking.tile_rows = tile[0];
+                blocking.depth = tile[1];
+                Grid out(size[0], size[1]);
+                grid.advance_blocked(out, 23, blocking);
+                CHECK(out == expected);
+            }
+        }
+    }
+
+    SUBCASE("moves less memory than one pass per generation") {
+        Grid grid(256, 512);
+        grid.random();
+        Simulation blocked(grid);
+        Simulation stepped(grid);
+        blocked.set_advance_mode(AdvanceMode::TemporalBlocking);
+        blocked.set_blocking(64, 8);
+
+        CHECK(blocked.advance(40) == stepped.advance(40));
+        CHECK(blocked.get_generation() == 40);
+        CHECK(blocked.get_blocking().naive_bytes == 2 * 40 * 512 * grid.get_stride() * 8);
+        CHECK(blocked.get_blocking().bytes_moved * 4 < blocked.get_blocking().naive_bytes);
+    }
+}
+
+TEST_CASE("Test compressed history") {
+
+    SUBCASE("seek() reaches every entry from every other") {
+        Grid grid(150, 40);
+        grid.random();
+        History log(4);
+        std::vector<Grid> grids = {grid};
+        log.push_keyframe(grid);
+        for (int i = 1; i < 15; ++i) {
+            Grid next = grids.back().get_next_state();
+            if (i == 6) {
+                next.set_cell(7, 7, !next.get_cell(7, 7));
+                next.set_rule(rules::HIGHLIFE);
+                log.push_keyframe(next);
+            }
+            else {
+                log.push(grids.back(), next);
+            }
+            grids.push_back(next);
+        }
+        CHECK(log.size() == 15);
+        CHECK(log.stats().keyframes == 5);
+        for (size_t from = 0; from < grids.size(); ++from) {
+            for (size_t to = 0; to < grids.size(); ++to) {
+                Grid g = grids[from];
+                log.seek(g, from, to, nullptr);
+                CHECK(g == grids[to]);
+                CHECK(g.get_rule() == grids[to].get_rule());
+            }
+            CHECK(log.get(from, nullptr) == grids[from]);
+        }
+        log.truncate(3);
+        CHECK(log.size() == 3);
+        CHECK(log.get(2, nullptr) == grids[2]);
+    }
+
+    SUBCASE("prev() and reset() rebuild what step() computed") {
+        Grid grid(100, 70);
+        grid.random();
+        Simulation s(grid);
+        s.set_keyframe_interval(8);
+        std::vector<Grid> expected = {grid};
+        for (int gen = 0; gen < 40; ++gen) {
+            s.step();
+            expected.push_back(expected.back().get_next_state());
+        }
+        CHECK(s.current() == expected[40]);
+        for (int tick = 39; tick >= 20; --tick) {
+            CHECK(s.prev() == expected[tick]);
+        }
+        s.set_cell(0, 0, !s.get_cell(0, 0));
+        Grid edited = s.current();
+        s.step();
+        CHECK(s.current() == edited.get_next_state());
+        CHECK(s.prev() == edited);
+        CHECK(s.prev() == expected[19]);
+        CHECK(s.reset() == grid);
+        CHECK(s.next() == expected[1]);
+    }
+
+    SUBCASE("a glider's history takes a small fraction of full grids") {
+        std::vector<std::vector<bool>> cells = {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}};
+        Grid grid(1000, 1000);
+        grid.place(Grid(3, 3, cells), 10, 10);
+        Simulation s(grid);
+        for (int gen = 0; gen < 500; ++gen) {
+            s.step();
+        }
+        const HistoryStats stats = s.get_history_stats();
+        CHECK(stats.entries == 501);
+        CHECK(stats.keyframes == 8);
+        CHECK(stats.raw_bytes == 501 * 1000 * 16 * 8);
+        CHECK(stats.bytes * 1000 < stats.raw_bytes);
+        CHECK(s.reset() == grid);
+    }
+
+    SUBCASE("a budget keeps checkpoints and recomputes the rest") {
+        Grid grid(200, 100);
+        grid.random();
+        Simulation s(grid);
+        const uint64_t budget = 64 * 1024;
+        s.set_history_budget(budget);
+        std::vector<Grid> expected = {grid};
+        for (int gen = 0; gen < 300; ++gen) {
+            if (gen == 150) {
+                s.set_cell(1, 1, !s.get_cell(1, 1));
+                expected.back() = s.current();
+            }
+            s.step();
+            expected.push_back(expected.back().get_next_state());
+        }
+        HistoryStats stats = s.get_history_stats();
+        CHECK(stats.entries == 301);
+        CHECK(stats.bytes <= budget);
+        CHECK(stats.dropped > 0);
+        CHECK(stats.spacing >= 16);
+        const std::vector<size_t> checkpoints = s.get_checkpoints();
+        CHECK(checkpoints.front() == 0);
+        CHECK(std::find(checkpoints.begin(), checkpoints.end(), 150) != checkpoints.end());
+
+        for (int tick = 299; tick >= 0; --tick) {
+            CHECK(s.prev() == expected[tick]);
+        }
+        stats = s.get_history_stats();
+        CHECK(stats.backward_seeks == 300);
+        CHECK(stats.backward_recomputed > 0);
+        CHECK(stats.bytes <= budget);
+        for (int tick = 1; tick <= 300; ++tick) {
+            CHECK(s.next() == expected[tick]);
+        }
+        CHECK(s.get_steps() == 300);
+
+        s.set_history_budget(0);
+        s.reset();
+        CHECK(s.get_history_stats().budget == 0);
+        CHECK(s.current() == grid);
+    }
+
+    SUBCASE("a long recording stays within the budget") {
+        Grid grid(200, 100);
+        grid.random();
+        Simulation s(grid);
+        const uint64_t budget = 16 * 1024;
+        s.set_history_budget(budget);
+        std::vector<Grid> expected = {grid};
+        for (int gen = 0; gen < 3000; ++gen) {
+            if (gen % 500 == 250) {
+                // pinned keyframes that thinning cannot drop
+                s.set_cell(gen % 200, 1, !s.get_cell(gen % 200, 1));
+                expected.back() = s.current();
+            }
+            s.step();
+            expected.push_back(expected.back().get_next_state());
+            REQUIRE(s.get_history_stats().bytes <= budget);
+        }
+        HistoryStats stats = s.get_history_stats();
+        CHECK(stats.entries < 3001);
+        CHECK(s.get_tick() == stats.entries - 1);
+        CHECK(s.get_generation() == 3000);
+
+        // the oldest generation left is still the right one
+        const uint64_t oldest = 3000 - s.get_tick();
+        CHECK(s.reset() == expected[oldest]);
+        CHECK(s.get_generation() == oldest);
+        for (uint64_t gen = oldest + 1; gen <= 3000; ++gen) {
+            CHECK(s.next() == expected[gen]);
+        }
+        CHECK(s.get_history_stats().bytes <= budget);
+
+        // below one keyframe only the current generation is kept
+        s.set_history_budget(1);
+        stats = s.get_history_stats();
+        CHECK(stats.entries == 1);
+        CHECK(s.get_tick() == 0);
+        CHECK(s.current() == expected[3000]);
+    }
+}
+
+TEST_CASE("Test wavefront pipelining") {
+
+    SUBCASE("matches n calls of get_next_state() for any thread count") {
+        const size_t sizes[][2] = {{200, 100}, {70, 5}, {64, 3}};
+        for (const auto& size : sizes) {
+            Grid grid(size[0], size[1]);
+            grid.set_rule(rules::HIGHLIFE);
+            grid.random();
+            for (uint64_t n : {1, 2, 7, 20}) {
+                Grid expected = grid;
+                for (uint64_t i = 0; i < n; ++i) {
+                    expected = expected.get_next_state();
+                }
+                for (size_t threads : {1, 2, 3, 4, 8}) {
+                    ThreadPool pool(threads);
+                    for (bool barrier : {false, true}) {
+                        Wavefront wavefront;
+                        wavefront.barrier = barrier;
+                        Grid out(size[0], size[1]);
+                        grid.advance_wavefront(out, n, threads > 1 ? &pool : nullptr, wavefront);
+                        CHECK(out == expected);
+                        CHECK(out.get_rule() == rules::HIGHLIFE);
+                        CHECK(wavefront.busy_seconds > 0);
+                        CHECK(wavefront.wait_seconds >= 0);
+                    }
+                }
+            }
+        }
+    }
+
+    SUBCASE("Simulation::advance() in wavefront mode") {
+        Grid grid(128, 96);
+        grid.random();
+        Simulation s(grid);
+        Simulation reference(grid);
+        s.set_threads(3);
+        s.set_advance_mode(AdvanceMode::Wavefront);
+        s.advance(25);
+        reference.advance(25);
+        CHECK(s.current() == reference.current());
+        CHECK(s.get_generation() == 25);
+        CHECK(s.get_wavefront().busy_seconds > 0);
+
+        s.set_wavefront_barrier(true);
+        s.advance(10);
+        reference.advance(10);
+        CHECK(s.current() == reference.current());
+        CHECK(s.get_wavefront().barrier);
+    }
+}
+
+TEST_CASE("Test thread pool") {
+
+    SUBCASE("run() calls every worker once per job") {
+        ThreadPool pool(4);
+        CHECK(pool.size() == 4);
+        std::vector<int> calls(pool.size(), 0);
+        for (int job = 0; job < 100; ++job) {
+            pool.run([&](size_t i) { calls[i]++; });
+        }
+        for (int c : calls) {
+            CHECK(c == 100);
+        }
+        CHECK_THROWS(pool.run([](size_t i) { if (i == 2) throw std::runtime_error("worker failed"); }));
+        std::atomic<int> after{0};
+        pool.run([&](size_t) { after++; });
+        CHECK(after == 4);
+    }
+
+    SUBCASE("strips match the single-threaded result for any thread count") {
+        const size_t sizes[][2] = {{1, 1}, {70, 3}, {130, 17}, {200, 200}, {1000, 64}};
+        for (size_t threads : {2, 3, 5, 8}) {
+            ThreadPool pool(threads, true);
+            for (const auto& size : sizes) {
+                Grid grid(size[0], size[1]);
+                grid.random();
+                grid.set_rule(threads % 2 ? rules::HIGHLIFE : rules::CONWAY);
+                Grid single(size[0], size[1]);
+                Grid parallel(size[0], size[1]);
+                for (int gen = 0; gen < 4; ++gen) {
+                    grid.step_into(single);
+                    grid.step_into(parallel, Engine::Bitsliced, &pool);
+                    CHECK(single == parallel);
+                    grid = single;
+                }
+            }
+        }
+    }
+
+    SUBCASE("Simulation::set_threads() with and without history") {
+        Grid grid(300, 120);
+        grid.random();
+        Simulation single(grid);
+        for (bool history : {true, false}) {
+            Simulation threaded(grid);
+            threaded.set_history(history);
+            threaded.set_threads(6);
+            CHECK(threaded.get_threads() == 6);
+            Simulation reference(grid);
+            for (int gen = 0; gen < 20; ++gen) {
+                threaded.step();
+                reference.step();
+                CHECK(threaded.current() == reference.current());
+            }
+            CHECK(threaded.advance(30) == reference.advance(30));
+        }
+        single.set_threads(1);
+        CHECK(single.get_threads() == 1);
+    }
+}
+
+TEST_CASE("Test work-stealing scheduler") {
+
+    SUBCASE("run() calls every task exactly once") {
+        WorkStealingScheduler scheduler(4);
+        std::vector<std::atomic<int>> calls(1000);
+        for (auto& c : calls) c = 0;
+        // a few very expensive tasks at the front of worker 0's share
+        scheduler.run(calls.size(), [&](size_t task, size_t) {
+            if (task < 3) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            calls[task]++;
+        });
+        uint64_t tasks = 0;
+        for (const auto& c : calls) {
+            CHECK(c == 1);
+        }
+        for (const auto& w : scheduler.last_stats()) {
+            tasks += w.tasks;
+        }
+        CHECK(tasks == calls.size());
+        CHECK(scheduler.utilization(0) > 0);
+        CHECK(scheduler.utilization(0) <= 1);
+    }
+
+    SUBCASE("tile stepping matches step_into() with edits in between") {
+        for (size_t threads : {1, 3, 4}) {
+            WorkStealingScheduler scheduler(threads);
+            for (bool history : {true, false}) {
+                Grid grid(700, 150);
+                grid.random();
+                Simulation tiled(grid);
+                Simulation reference(grid);
+                tiled.set_history(history);
+                reference.set_history(history);
+                tiled.set_threads(threads, false, Schedule::WorkStealing);
+                CHECK(tiled.get_schedule() == Schedule::WorkStealing);
+                for (int gen = 0; gen < 60; ++gen) {
+                    tiled.step();
+                    reference.step();
+                    if (gen % 17 == 5) {
+                        tiled.set_cell(gen * 13 % 700, gen * 7 % 150, LIVE);
+                        reference.set_cell(gen * 13 % 700, gen * 7 % 150, LIVE);
+                    }
+                    CHECK(tiled.current() == reference.current());
+                }
+                CHECK(tiled.advance(25) == reference.advance(25));
+                tiled.reset();
+                reference.reset();
+                CHECK(tiled.next() == reference.next());
+            }
+        }
+    }
+
+    SUBCASE("the change map is only kept for the grids of the last step") {
+        WorkStealingScheduler scheduler(2);
+        TileActivity activity;
+        auto blinker = [](Grid& g, size_t x, size_t y) {
+            for (size_t i = 0; i < 3; ++i) g.set_cell(x + i, y, LIVE);
+        };
+        Grid a(2048, 512);
+        Grid b(2048, 512);
+        blinker(a, 10, 10);
+        a.step_tiles(b, scheduler, activity);
+        CHECK(activity.describes(b));
+        CHECK(!activity.describes(a));
+
+        // a write the map is not told about, into the last result
+        blinker(b, 400, 100);
+        CHECK(!activity.describes(b));
+        Grid expected = b.get_next_state();
+        b.step_tiles(a, scheduler, activity);
+        CHECK(a == expected);
+
+        // a different board assigned to the last result
+        Grid other(2048, 512);
+        blinker(other, 600, 20);
+        a = other;
+        expected = a.get_next_state();
+        a.step_tiles(b, scheduler, activity);
+        CHECK(b == expected);
+
+        // a write into the last source, which the next step would otherwise keep
+        a.set_cell(650, 140, LIVE);
+        expected = b.get_next_state();
+        b.step_tiles(a, scheduler, activity);
+        CHECK(a == expected);
+
+        // an edit the map is told about keeps it
+        a.set_cell(200, 50, LIVE);
+        activity.touch(a, 200, 50);
+        CHECK(activity.describes(a));
+        expected = a.get_next_state();
+        a.step_tiles(b, scheduler, activity);
+        CHECK(b == expected);
+        CHECK(activity.computed < activity.columns * activity.rows);
+    }
+
+    SUBCASE("only tiles around a spaceship are computed") {
+        FileHandler f;
+        Grid board(2048, 1024);
+        board.place(f.read("data/copperhead.rle"), 1000, 500);
+        Simulation s(board);
+        s.set_history(false);
+        s.set_threads(4, false, Schedule::WorkStealing);
+        Simulation reference(board);
+        reference.set_history(false);
+        for (int gen = 0; gen < 50; ++gen) {
+            s.step();
+            reference.step();
+        }
+        CHECK(s.current() == reference.current());
+        const TileActivity& tiles = s.get_tile_activity();
+        CHECK(tiles.computed > 0);
+        CHECK(tiles.computed <= 18);
+        CHECK(tiles.copied == 0);
+        CHECK(tiles.computed + tiles.skipped == tiles.columns * tiles.rows);
+        uint64_t tasks = 0;
+        for (const auto& w : s.get_scheduler()->last_stats()) {
+            tasks += w.tasks;
+        }
+        CHECK(tasks == tiles.computed);
+    }
+}
+
+TEST_CASE("Test engine thread") {
+
+    SUBCASE("triple buffer hands over the newest value") {
+        TripleBuffer<int> buffer(0);
+        CHECK(!buffer.fresh());
+        CHECK(buffer.read() == 0);
+        buffer.write() = 1;
+        buffer.publish();
+        buffer.write() = 2;
+        buffer.publish();
+        CHECK(buffer.fresh());
+        CHECK(buffer.read() == 2);
+        CHECK(!buffer.fresh());
+        CHECK(buffer.read() == 2);
+    }
+
+    SUBCASE("triple buffer never tears or goes back across threads") {
+        struct Pair {
+            uint64_t a;
+            uint64_t b;
+        };
+        TripleBuffer<Pair> buffer(Pair{0, ~uint64_t(0)});
+        const uint64_t last = 200000;
+        std::thread writer([&] {
+            for (uint64_t i = 1; i <= last; ++i) {
+                buffer.write() = Pair{i, ~i};
+                buffer.publish();
+            }
+        });
+        uint64_t seen = 0;
+        bool consistent = true;
+        while (seen != last) {
+            const Pair& p = buffer.read();
+            consistent = consistent && p.b == ~p.a && p.a >= seen;
+            seen = p.a;
+        }
+        writer.join();
+        CHECK(consistent);
+    }
+
+    SUBCASE("commands run in order and publish a frame") {
+        std::vector<std::vector<bool>> cells = {{DEAD, LIVE, DEAD}, {DEAD, DEAD, LIVE}, {LIVE, LIVE, LIVE}};
+        Grid grid(30, 20);
+        grid.place(Grid(3, 3, cells), 5, 5);
+        SimRunner runner(grid);
+        Simulation reference(grid);
+        CHECK(runner.frame().grid == grid);
+
+        runner.set_cell(20, 10, LIVE);
+        reference.set_cell(20, 10, LIVE);
+        for (int i = 0; i < 5; ++i) {
+            runner.next();
+            reference.next();
+        }
+        runner.prev();
+        reference.prev();
+        runner.sync();
+        CHECK(runner.has_new_frame());
+        CHECK(runner.frame().grid == reference.current());
+        CHECK(runner.frame().tick == 4);
+        CHECK(!runner.has_new_frame());
+
+        runner.reset();
+        reference.reset();
+        runner.prev();
+        runner.sync();
+        CHECK(runner.frame().grid == reference.current());
+        CHECK(runner.frame().tick == 0);
+    }
+
+    SUBCASE("a paused engine precomputes ahead and edits drop it") {
+        Grid grid(256, 256);
+        grid.random();
+        SimRunner runner(grid);
+        const size_t lookahead = runner.get_lookahead();
+        auto precomputed = [&] {
+            size_t ahead = 0;
+            runner.post([&](Simulation& s) { ahead = s.get_precomputed(); });
+            runner.sync();
+            return ahead;
+        };
+        for (int i = 0; i < 1000 && precomputed() < lookahead; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(precomputed() == lookahead);
+
+        // nothing is computed on demand or in the background from here on
+        uint64_t steps = 0;
+        runner.set_lookahead(0);
+        runner.next();
+        runner.next();
+        runner.post([&](Simulation& s) { steps = s.get_steps(); });
+        runner.sync();
+        CHECK(steps == lookahead);
+        CHECK(runner.frame().grid == grid.get_next_state().get_next_state());
+
+        runner.set_cell(0, 0, LIVE);
+        runner.sync();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CHECK(precomputed() == 0);
+        runner.next();
+        runner.sync();
+        Grid expected = grid.get_next_state().get_next_state();
+        expected.set_cell(0, 0, LIVE);
+        CHECK(runner.frame().grid == expected.get_next_state());
+        CHECK(runner.frame().tick == 3);
+    }
+
+    SUBCASE("playing steps on its own until paused") {
+        Grid grid(64, 64);
+        grid.random();
+        SimRunner runner(grid);
+        runner.set_delay(0);
+        runner.play();
+        CHECK(runner.is_playing());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        runner.pause();
+        runner.sync();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const SimRunner::Frame& f = runner.frame();
+        CHECK(f.generation > 0);
+        Grid expected = grid;
+        for (uint64_t i = 0; i < f.generation; ++i) {
+            expected = expected.get_next_state();
+        }
+        CHECK(f.grid == expected);
+    }
 }
 
 TEST_CASE("test file handling and parsing") {
@@ -181,6 +1653,130 @@ TEST_CASE("test file handling and parsing") {
         f1.save(s.cur(), "test.rle");
         auto g3 = f1.read("test.rle");
         CHECK(compare_grid(s.cur(), g3) == true);
+        CHECK(g3.get_rule() == rules::CONWAY);
+    }
+
+    SUBCASE("the rle rule header is read and saved") {
+        CHECK(f1.read("data/ex1.rle").get_rule() == rules::CONWAY);
+
+        Grid g1 = test_grid;
+        g1.set_rule(rules::DAY_AND_NIGHT);
+        f1.save(g1, "test.rle");
+        auto g2 = f1.read("test.rle");
+        CHECK(g2.get_rule() == rules::DAY_AND_NIGHT);
+        CHECK(compare_grid(g1, g2) == true);
+
+        std::stringstream legacy("#C survival/birth notation\nx = 3, y = 3, rule = 23/36\nbo$2bo$3o!\n");
+        RLE_Parser parser(legacy);
+        auto g3 = parser.read();
+        CHECK(g3.get_rule() == rules::HIGHLIFE);
+        CHECK(compare_grid(test_grid, g3) == true);
+
+        // what loading in the app does: centered on the board, run, and saved again
+        Grid highlife = test_grid;
+        highlife.set_rule(rules::HIGHLIFE);
+        f1.save(highlife, "test.rle");
+        const Grid board = f1.read_centered("test.rle", 20, 20);
+        CHECK(board.get_rule() == rules::HIGHLIFE);
+        CHECK(board.get_cell(10, 9));
+        SimRunner runner(Grid(20, 20));
+        runner.replace(board);
+        runner.next();
+        runner.sync();
+        CHECK(runner.frame().grid == board.get_next_state());
+        f1.save(GridView(runner.frame().grid).minimal(), "test.rle");
+        CHECK(f1.read("test.rle").get_rule() == rules::HIGHLIFE);
+    }
+
+    SUBCASE("the rle decoder fills runs across words and rows") {
+        // multi-digit runs, counted line ends, line breaks, and a run past the width
+        std::stringstream rle("x = 200, y = 5\n70b100o$\n3$130b\n80o!");
+        RLE_Parser parser(rle);
+        const Grid g = parser.read();
+        Grid expected(200, 5);
+        for (size_t x = 70; x < 170; ++x) expected.set_cell(x, 0, LIVE);
+        for (size_t x = 130; x < 200; ++x) expected.set_cell(x, 4, LIVE);
+        CHECK(g == expected);
+
+        // fed a byte at a time, the decoder ends up with the same grid
+        const std::string body = "70b100o$\n3$130b\n80o!ignored";
+        Grid piecewise(200, 5);
+        RLE_Decoder decoder(piecewise);
+        for (char ch : body) {
+            decoder.feed(&ch, 1);
+        }
+        CHECK(decoder.finished());
+        CHECK(piecewise == expected);
+
+        std::stringstream bad("x = 3, y = 3\nbo$2bx!");
+        RLE_Parser bad_parser(bad);
+        CHECK_THROWS(bad_parser.read());
+    }
+
+    SUBCASE("mapped files parse like streams") {
+        // comments, CRLF line ends and a header spread with blanks
+        const std::string rle = "#N Glider\r\n#C two lines\r\nx=3 ,y= 3,rule = B36/S23\r\nbo$2bo$\r\n3o!\r\n";
+        const std::string txt = "!Name: Glider\r\n!\r\n.O.\r\n..O\r\nOOO\r\n";
+        const std::string life = "#Life 1.06\r\n-4 7\r\n-3 5\r\n\t-3  7\r\n-2 6\r\n-2 7\r\n";
+        for (const auto& [name, text] : {std::pair<std::string, std::string>{"test.rle", rle},
+                                         {"test.txt", txt},
+                                         {"test.life", life}}) {
+            std::ofstream(name, std::ios::binary) << text;
+            const Grid mapped = f1.read(name);
+            CHECK(compare_grid(test_grid, mapped) == true);
+
+            std::stringstream stream(text);
+            std::unique_ptr<Parser> parser;
+            if (name == "test.rle") parser = std::make_unique<RLE_Parser>(stream);
+            else if (name == "test.txt") parser = std::make_unique<Plaintext_Parser>(stream);
+            else parser = std::make_unique<Life106_Parser>(stream);
+            CHECK(parser->read() == mapped);
+        }
+        CHECK(RLE_Parser::parse(rle).get_rule() == rules::HIGHLIFE);
+
+        std::ofstream("empty.life");
+        CHECK(f1.read("empty.life").get_width() == 0);
+        CHECK_THROWS(f1.read("missing.rle"));
+        CHECK_THROWS(Life106_Parser::parse("#Life 1.06\n1 x\n"));
+        CHECK_THROWS(RLE_Parser::parse("x = three, y = 3\nbo!"));
+    }
+
+    SUBCASE("writers work from runs and live cells") {
+        // dead cells ending rows and empty rows ending the pattern are left out
+        Grid g(200, 6);
+        for (size_t x = 70; x < 170; ++x) g.set_cell(x, 0, LIVE);
+        g.set_cell(0, 3, LIVE);
+        g.set_cell(2, 3, LIVE);
+        std::stringstream rle;
+        RLE_Parser(rle).save(g);
+        CHECK(rle.str() == "x = 200, y = 6, rule = B3/S23\n70b100o3$obo!\n");
+        CHECK(RLE_Parser::parse(rle.str()) == g);
+
+        std::stringstream life;
+        Life106_Parser(life).save(GridView(g).window(1, 3, 2, 1));
+        CHECK(life.str() == "#Life 1.06\n1 0\n");
+
+        std::stringstream txt;
+        Plaintext_Parser(txt).save(GridView(g).window(0, 2, 4, 2));
+        CHECK(txt.str() == "....\nO.O.\n");
+
+        // a soup wraps within 70 columns and reads back, windows off word boundaries too
+        Grid soup(500, 300);
+        soup.random();
+        for (const GridView view : {GridView(soup), GridView(soup).window(37, 11, 400, 250)}) {
+            std::stringstream out;
+            RLE_Parser(out).save(view);
+            std::string line;
+            std::getline(out, line);
+            while (std::getline(out, line)) {
+                CHECK(line.size() <= RLE_Parser::LINE_WIDTH);
+            }
+            CHECK(RLE_Parser::parse(out.str()) == Grid(view));
+
+            std::stringstream plain;
+            Plaintext_Parser(plain).save(view);
+            CHECK(Plaintext_Parser::parse(plain.str()) == Grid(view));
+        }
     }
 
     SUBCASE("test read and save for txt files") {